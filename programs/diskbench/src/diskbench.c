@@ -0,0 +1,48 @@
+#include "diskbench.h"
+#include "stdio.h"
+#include "toyos.h"
+
+// sectors read per pass, as a power of two since there is no 64-bit division in user land
+#define DISKBENCH_SECTORS_SHIFT 12
+
+// largest request size measured, in sectors
+#define DISKBENCH_MAX_REQUEST 128
+
+// average cycles per sector for a sequential read from the start of the boot disk
+static int diskbench_run(char* buf, int request, int flags, uint32_t* cycles_per_sector) {
+    uint64_t start = toyos_read_tsc();
+    for (int lba = 0; lba < (1 << DISKBENCH_SECTORS_SHIFT); lba += request) {
+        int res = toyos_disk_read(0, lba, request, buf, flags);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    uint64_t cycles = toyos_read_tsc() - start;
+    *cycles_per_sector = (uint32_t)(cycles >> DISKBENCH_SECTORS_SHIFT);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    char* buf = toyos_malloc(DISKBENCH_MAX_REQUEST * 512);
+    if (!buf) {
+        printf("diskbench: out of memory\n");
+        return -1;
+    }
+
+    printf("diskbench - sequential read of %i KB, cycles per sector\n", (1 << DISKBENCH_SECTORS_SHIFT) / 2);
+
+    for (int request = 1; request <= DISKBENCH_MAX_REQUEST; request *= 8) {
+        uint32_t pio = 0;
+        uint32_t dma = 0;
+        if (diskbench_run(buf, request, TOYOS_DISK_READ_PIO, &pio) < 0 || diskbench_run(buf, request, 0, &dma) < 0) {
+            printf("diskbench: read failed\n");
+            break;
+        }
+
+        printf("%i sectors per request: pio %i, dma %i\n", request, pio, dma);
+    }
+
+    toyos_free(buf);
+    return 0;
+}
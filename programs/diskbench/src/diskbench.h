@@ -0,0 +1,4 @@
+#ifndef _DISKBENCH_H
+#define _DISKBENCH_H
+
+#endif
@@ -5,16 +5,12 @@
 #include "stdlib.h"
 
 int main(int argc, char** argv) {
-    // get process list (must be freed... memory is allocated)
+    // get process list, terminated by an entry with id -1 (must be freed... memory is allocated)
     struct process_info* processes = (struct process_info*)toyos_get_processes();
 
     // find process with longest filename for formatting purposes
     int max_pid_len = 0;
-    for (int i = 0; i < TOYOS_MAX_PROCESSES; i++) {
-        if (processes[i].id < 0) {
-            continue;
-        }
-
+    for (int i = 0; processes[i].id >= 0; i++) {
         int pid_len = strlen(itoa(processes[i].id));
         if (pid_len > max_pid_len) {
             max_pid_len = pid_len;
@@ -28,11 +24,7 @@ int main(int argc, char** argv) {
     printf(" PID  %sPATH\n", padding);
     printf(" ---  %s----\n", padding);
 
-    for (int i = 0; i < TOYOS_MAX_PROCESSES; i++) {
-        if (processes[i].id < 0) {
-            continue;
-        }
-
+    for (int i = 0; processes[i].id >= 0; i++) {
         // add any necessary padding to the filename
         char this_padding[max_pid_len - strlen(processes[i].filename)];
         strncpy(this_padding, "     ", max_pid_len);
@@ -14,43 +14,99 @@ int putchar(int c) {
     return 0;
 }
 
+// Size of the buffer printf formats into before writing it out
+#define PRINTF_BUFFER_SIZE 256
+
+/**
+ * @brief Output collected by printf, written to the console when full or when printf returns.
+ */
+struct printf_buffer {
+    char data[PRINTF_BUFFER_SIZE];
+    int len;
+};
+
+/**
+ * @brief Writes out and empties the buffer.
+ *
+ * @param out The buffer to flush.
+ */
+static void printf_flush(struct printf_buffer *out) {
+    if (out->len) {
+        toyos_write(TOYOS_STDOUT, out->data, out->len);
+        out->len = 0;
+    }
+}
+
+/**
+ * @brief Appends a character to the buffer, flushing it first if it is full.
+ *
+ * @param out The buffer to append to.
+ * @param c The character to append.
+ */
+static void printf_putc(struct printf_buffer *out, char c) {
+    if (out->len == PRINTF_BUFFER_SIZE) {
+        printf_flush(out);
+    }
+
+    out->data[out->len++] = c;
+}
+
+/**
+ * @brief Appends a null terminated string to the buffer.
+ *
+ * @param out The buffer to append to.
+ * @param str The string to append.
+ */
+static void printf_puts(struct printf_buffer *out, const char *str) {
+    while (*str) {
+        printf_putc(out, *str++);
+    }
+}
+
 /**
  * @brief Writes a formatted string to the screen.
+ *
+ * The output is collected and written with one system call, rather than one per character.
  * 
  * @param fmt The format string.
  * @return int 0 on success, negative on failure.
  */
 int printf(const char *fmt, ...) {
+    struct printf_buffer out;
     va_list ap;
     const char *p;
     char* sval;
     int ival;
 
+    out.len = 0;
+
     va_start(ap, fmt);
     for (p = fmt; *p; p++) {
         if (*p != '%') {
-            putchar(*p);
+            printf_putc(&out, *p);
             continue;
         }
 
         switch (*++p) {
             case 'i':
                 ival = va_arg(ap, int);
-                print(itoa(ival));
+                printf_puts(&out, itoa(ival));
                 break;
 
             case 's':
                 sval = va_arg(ap, char *);
-                print(sval);
+                printf_puts(&out, sval);
                 break;
 
             default:
-                putchar(*p);
+                printf_putc(&out, *p);
                 break;
         }
     }
 
     va_end(ap);
 
+    printf_flush(&out);
+
     return 0;
 }
@@ -2,6 +2,9 @@
 
 section .asm
 
+; Set in EAX to pass system call arguments in EBX, ECX, EDX, ESI and EDI rather than on the stack
+%define TOYOS_SYSCALL_REGISTER_ABI 0x8000
+
 global print:function
 global toyos_getkey:function
 global toyos_malloc:function
@@ -21,15 +24,62 @@ global toyos_socket:function
 global toyos_bind:function
 global toyos_sendto:function
 global toyos_recvfrom:function
+global toyos_get_lock_stats:function
+global toyos_get_process_stats:function
+global toyos_get_irq_latency:function
+global toyos_null_syscall:function
+global toyos_null_syscall_int80:function
+global toyos_read_tsc:function
+global toyos_ring_setup:function
+global toyos_ring_enter:function
+global toyos_get_syscall_stats:function
+global toyos_write:function
+global toyos_disk_read:function
+global toyos_get_bcache_stats:function
+global toyos_sync:function
+global toyos_statfs:function
+
+; Issues the system call in EAX with its arguments in EBX, ECX, EDX, ESI and EDI.
+; SYSENTER is used when the CPU supports it, otherwise int 0x80. SYSENTER saves no return state,
+; so EBP, ECX and EDX are pushed and EBP points at them for the kernel, which returns straight to
+; the caller of this routine. ECX and EDX are not preserved.
+toyos_syscall:
+    cmp byte [sysenter_checked], 0
+    jne .dispatch
+    call toyos_detect_sysenter
+.dispatch:
+    cmp byte [sysenter_supported], 0
+    je .legacy
+    push ebp
+    push ecx
+    push edx
+    mov ebp, esp
+    sysenter
+.legacy:
+    int 0x80
+    ret
+
+; Checks CPUID for SYSENTER support, which the kernel enables whenever the CPU has it
+toyos_detect_sysenter:
+    pushad
+    mov eax, 1
+    cpuid
+    shr edx, 11 ; SEP feature bit
+    and edx, 1
+    mov [sysenter_supported], dl
+    mov byte [sysenter_checked], 1
+    popad
+    ret
 
 ; void print(const char* filename)
 print:
     push ebp
     mov ebp, esp
-    push dword[ebp+8]
-    mov eax, 1 ; Command print
-    int 0x80
-    add esp, 4 ; undo push
+    push ebx
+    mov ebx, [ebp+8] ; Variable "filename"
+    mov eax, 1 | TOYOS_SYSCALL_REGISTER_ABI ; Command print
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -37,8 +87,8 @@ print:
 toyos_getkey:
     push ebp
     mov ebp, esp
-    mov eax, 2 ; Command getkey
-    int 0x80
+    mov eax, 2 | TOYOS_SYSCALL_REGISTER_ABI ; Command getkey
+    call toyos_syscall
     pop ebp
     ret
 
@@ -46,8 +96,8 @@ toyos_getkey:
 toyos_get_processes:
     push ebp
     mov ebp, esp
-    mov eax, 11 ; Command 11 display process list
-    int 0x80
+    mov eax, 11 | TOYOS_SYSCALL_REGISTER_ABI ; Command 11 display process list
+    call toyos_syscall
     pop ebp
     ret
     
@@ -55,10 +105,11 @@ toyos_get_processes:
 toyos_malloc:
     push ebp
     mov ebp, esp
-    mov eax, 4 ; Command malloc (Allocates memory for the process)
-    push dword[ebp+8] ; Variable "size"
-    int 0x80
-    add esp, 4
+    mov eax, 4 | TOYOS_SYSCALL_REGISTER_ABI ; Command malloc (Allocates memory for the process)
+    push ebx
+    mov ebx, [ebp+8] ; Variable "size"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -66,10 +117,11 @@ toyos_malloc:
 toyos_free:
     push ebp
     mov ebp, esp
-    mov eax, 5 ; Command 5 free (Frees the allocated memory for this process)
-    push dword[ebp+8] ; Variable "ptr"
-    int 0x80
-    add esp, 4
+    mov eax, 5 | TOYOS_SYSCALL_REGISTER_ABI ; Command 5 free (Frees the allocated memory for this process)
+    push ebx
+    mov ebx, [ebp+8] ; Variable "ptr"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -77,10 +129,11 @@ toyos_free:
 toyos_putchar:
     push ebp
     mov ebp, esp
-    mov eax, 3 ; Command putchar
-    push dword [ebp+8] ; Variable "c"
-    int 0x80
-    add esp, 4
+    mov eax, 3 | TOYOS_SYSCALL_REGISTER_ABI ; Command putchar
+    push ebx
+    mov ebx, [ebp+8] ; Variable "c"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -88,10 +141,11 @@ toyos_putchar:
 toyos_process_load_start:
     push ebp
     mov ebp, esp
-    mov eax, 6 ; Command 6 process load start ( stars a process )
-    push dword[ebp+8] ; Variable "filename"
-    int 0x80
-    add esp, 4
+    mov eax, 6 | TOYOS_SYSCALL_REGISTER_ABI ; Command 6 process load start ( stars a process )
+    push ebx
+    mov ebx, [ebp+8] ; Variable "filename"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -99,8 +153,8 @@ toyos_process_load_start:
 toyos_exit:
     push ebp
     mov ebp, esp
-    mov eax, 7 ; Command 7 process exit
-    int 0x80
+    mov eax, 7 | TOYOS_SYSCALL_REGISTER_ABI ; Command 7 process exit
+    call toyos_syscall
     pop ebp
     ret
 
@@ -108,10 +162,11 @@ toyos_exit:
 toyos_process_get_arguments:
     push ebp
     mov ebp, esp
-    mov eax, 8 ; Command 8 Gets the process arguments
-    push dword[ebp+8] ; Variable arguments
-    int 0x80
-    add esp, 4
+    mov eax, 8 | TOYOS_SYSCALL_REGISTER_ABI ; Command 8 Gets the process arguments
+    push ebx
+    mov ebx, [ebp+8] ; Variable arguments
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -119,10 +174,11 @@ toyos_process_get_arguments:
 toyos_system:
     push ebp
     mov ebp, esp
-    mov eax, 9 ; Command 9 process_system ( runs a system command based on the arguments)
-    push dword[ebp+8] ; Variable "arguments"
-    int 0x80
-    add esp, 4
+    mov eax, 9 | TOYOS_SYSCALL_REGISTER_ABI ; Command 9 process_system ( runs a system command based on the arguments)
+    push ebx
+    mov ebx, [ebp+8] ; Variable "arguments"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -130,8 +186,8 @@ toyos_system:
 toyos_clear_terminal:
     push ebp
     mov ebp, esp
-    mov eax, 10 ; Command 10 clear terminal
-    int 0x80
+    mov eax, 10 | TOYOS_SYSCALL_REGISTER_ABI ; Command 10 clear terminal
+    call toyos_syscall
     pop ebp
     ret
 
@@ -139,8 +195,8 @@ toyos_clear_terminal:
 toyos_check_done:
     push ebp
     mov ebp, esp
-    mov eax, 12 ; Command 12 check lock
-    int 0x80
+    mov eax, 12 | TOYOS_SYSCALL_REGISTER_ABI ; Command 12 check lock
+    call toyos_syscall
     pop ebp
     ret
 
@@ -148,8 +204,8 @@ toyos_check_done:
 toyos_done:
     push ebp
     mov ebp, esp
-    mov eax, 13 ; Command 13 done
-    int 0x80
+    mov eax, 13 | TOYOS_SYSCALL_REGISTER_ABI ; Command 13 done
+    call toyos_syscall
     pop ebp
     ret
 
@@ -157,8 +213,8 @@ toyos_done:
 toyos_fork:
     push ebp
     mov ebp, esp
-    mov eax, 14 ; Command 14 fork
-    int 0x80
+    mov eax, 14 | TOYOS_SYSCALL_REGISTER_ABI ; Command 14 fork
+    call toyos_syscall
     pop ebp
     ret
 
@@ -167,10 +223,11 @@ toyos_fork:
 toyos_kill:
     push ebp
     mov ebp, esp
-    mov eax, 15 ; Command 15 kill
-    push dword[ebp+8] ; Variable "pid"
-    int 0x80
-    add esp, 4
+    mov eax, 15 | TOYOS_SYSCALL_REGISTER_ABI ; Command 15 kill
+    push ebx
+    mov ebx, [ebp+8] ; Variable "pid"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -180,10 +237,11 @@ toyos_kill:
 toyos_socket:
     push ebp
     mov ebp, esp
-    mov eax, 16 ; Command 16 socket
-    push dword[ebp+8] ; Variable "type"
-    int 0x80
-    add esp, 4
+    mov eax, 16 | TOYOS_SYSCALL_REGISTER_ABI ; Command 16 socket
+    push ebx
+    mov ebx, [ebp+8] ; Variable "type"
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -193,11 +251,12 @@ toyos_socket:
 toyos_bind:
     push ebp
     mov ebp, esp
-    mov eax, 17 ; Command 17 bind
-    push dword[ebp+12] ; Variable "port" (pushed first = stack item 1)
-    push dword[ebp+8]  ; Variable "sockfd" (pushed second = stack item 0)
-    int 0x80
-    add esp, 8
+    mov eax, 17 | TOYOS_SYSCALL_REGISTER_ABI ; Command 17 bind
+    push ebx
+    mov ebx, [ebp+8]  ; Variable "sockfd" (argument 0)
+    mov ecx, [ebp+12] ; Variable "port" (argument 1)
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -207,10 +266,11 @@ toyos_bind:
 toyos_sendto:
     push ebp
     mov ebp, esp
-    mov eax, 18 ; Command 18 sendto
-    push dword[ebp+8] ; Variable "args" (pointer to struct)
-    int 0x80
-    add esp, 4
+    mov eax, 18 | TOYOS_SYSCALL_REGISTER_ABI ; Command 18 sendto
+    push ebx
+    mov ebx, [ebp+8] ; Variable "args" (pointer to struct)
+    call toyos_syscall
+    pop ebx
     pop ebp
     ret
 
@@ -220,9 +280,185 @@ toyos_sendto:
 toyos_recvfrom:
     push ebp
     mov ebp, esp
-    mov eax, 19 ; Command 19 recvfrom
-    push dword[ebp+8] ; Variable "args" (pointer to struct)
+    mov eax, 19 | TOYOS_SYSCALL_REGISTER_ABI ; Command 19 recvfrom
+    push ebx
+    mov ebx, [ebp+8] ; Variable "args" (pointer to struct)
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+; struct spinlock_info* toyos_get_lock_stats(void)
+; Returns an array of TOYOS_MAX_SPINLOCKS lock statistics entries.
+; Unused entries have an empty name. The array must be freed with toyos_free.
+toyos_get_lock_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 20 | TOYOS_SYSCALL_REGISTER_ABI ; Command 20 lock stats
+    call toyos_syscall
+    pop ebp
+    ret
+
+; struct process_stats_info* toyos_get_process_stats(void)
+; Returns one resource usage entry per process, terminated by an entry with an id of -1.
+; The array must be freed with toyos_free.
+toyos_get_process_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 21 | TOYOS_SYSCALL_REGISTER_ABI ; Command 21 process stats
+    call toyos_syscall
+    pop ebp
+    ret
+
+; struct irq_latency_stats* toyos_get_irq_latency(void)
+; Returns the timer tick interval spread and the longest system call.
+; The structure must be freed with toyos_free.
+toyos_get_irq_latency:
+    push ebp
+    mov ebp, esp
+    mov eax, 22 | TOYOS_SYSCALL_REGISTER_ABI ; Command 22 interrupt latency
+    call toyos_syscall
+    pop ebp
+    ret
+
+; void toyos_null_syscall(void)
+; Enters and leaves the kernel without doing any work, through the fast entry path.
+toyos_null_syscall:
+    push ebp
+    mov ebp, esp
+    mov eax, 23 | TOYOS_SYSCALL_REGISTER_ABI ; Command 23 null
+    call toyos_syscall
+    pop ebp
+    ret
+
+; void toyos_null_syscall_int80(void)
+; Same as toyos_null_syscall, but always through int 0x80.
+toyos_null_syscall_int80:
+    push ebp
+    mov ebp, esp
+    mov eax, 23 | TOYOS_SYSCALL_REGISTER_ABI ; Command 23 null
     int 0x80
-    add esp, 4
     pop ebp
-    ret
\ No newline at end of file
+    ret
+
+; uint64_t toyos_read_tsc(void)
+; Returns the time stamp counter in EDX:EAX.
+toyos_read_tsc:
+    rdtsc
+    ret
+
+; struct toyos_ring* toyos_ring_setup(int flags)
+; Maps the submission and completion rings into the process, or returns the existing ones.
+toyos_ring_setup:
+    push ebp
+    mov ebp, esp
+    mov eax, 24 | TOYOS_SYSCALL_REGISTER_ABI ; Command 24 ring setup
+    push ebx
+    mov ebx, [ebp+8] ; Variable "flags"
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+; int toyos_ring_enter(void)
+; Rings the doorbell: the kernel runs the queued submissions and returns how many it ran.
+toyos_ring_enter:
+    push ebp
+    mov ebp, esp
+    mov eax, 25 | TOYOS_SYSCALL_REGISTER_ABI ; Command 25 ring enter
+    call toyos_syscall
+    pop ebp
+    ret
+
+; struct syscall_stats* toyos_get_syscall_stats(int pid)
+; Returns TOYOS_SYSCALL_STATS_MAX entries indexed by system call number, for one process or,
+; with a pid of -1, for all processes. The array must be freed with toyos_free.
+toyos_get_syscall_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 26 | TOYOS_SYSCALL_REGISTER_ABI ; Command 26 system call stats
+    push ebx
+    mov ebx, [ebp+8] ; Variable "pid"
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+; int toyos_write(int fd, const void *buf, size_t len)
+; Writes len bytes to the console and returns the number written, or a negative error code.
+toyos_write:
+    push ebp
+    mov ebp, esp
+    mov eax, 27 | TOYOS_SYSCALL_REGISTER_ABI ; Command 27 write
+    push ebx
+    mov ebx, [ebp+8]  ; Variable "fd"
+    mov ecx, [ebp+12] ; Variable "buf"
+    mov edx, [ebp+16] ; Variable "len"
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+; int toyos_disk_read(int disk, unsigned int lba, int total, void *buf, int flags)
+; Reads raw sectors and returns the number read, or a negative error code.
+toyos_disk_read:
+    push ebp
+    mov ebp, esp
+    mov eax, 28 | TOYOS_SYSCALL_REGISTER_ABI ; Command 28 disk read
+    push ebx
+    push esi
+    push edi
+    mov ebx, [ebp+8]  ; Variable "disk"
+    mov ecx, [ebp+12] ; Variable "lba"
+    mov edx, [ebp+16] ; Variable "total"
+    mov esi, [ebp+20] ; Variable "buf"
+    mov edi, [ebp+24] ; Variable "flags"
+    call toyos_syscall
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
+
+; struct bcache_stats* toyos_get_bcache_stats(void)
+; Returns the hit, miss and write-back counts of the buffer cache.
+; The structure must be freed with toyos_free.
+toyos_get_bcache_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 29 | TOYOS_SYSCALL_REGISTER_ABI ; Command 29 buffer cache statistics
+    call toyos_syscall
+    pop ebp
+    ret
+
+; int toyos_sync(int disk)
+; Writes the cached data of a disk, or of every disk if -1, back to the disk.
+toyos_sync:
+    push ebp
+    mov ebp, esp
+    mov eax, 30 | TOYOS_SYSCALL_REGISTER_ABI ; Command 30 sync
+    push ebx
+    mov ebx, [ebp+8] ; Variable "disk"
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+; struct file_statfs* toyos_statfs(int disk)
+; Returns the size and free space of the file system on a disk.
+; The structure must be freed with toyos_free.
+toyos_statfs:
+    push ebp
+    mov ebp, esp
+    mov eax, 31 | TOYOS_SYSCALL_REGISTER_ABI ; Command 31 file system status
+    push ebx
+    mov ebx, [ebp+8] ; Variable "disk"
+    call toyos_syscall
+    pop ebx
+    pop ebp
+    ret
+
+section .data
+
+sysenter_checked db 0   ; Set once CPUID has been checked for SYSENTER
+sysenter_supported db 0 ; Set if system calls can use SYSENTER
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 extern int toyos_check_done(void);
 
+static const struct toyos_vvar* const vvar = (const struct toyos_vvar*)TOYOS_VVAR_ADDRESS;
+
 struct command_argument* toyos_parse_command(const char* command, int max) {
     struct command_argument* root_command = 0;
     char scommand[1025];
@@ -94,16 +96,64 @@ int toyos_system_run(const char* command) {
 }
 
 void toyos_wait(void) {
+    // the kernel yields to the child process while it is running,
+    // so there is no need to burn time in user land between checks
+    while (toyos_check_done() != 0) {
+    }
+}
+
+struct ring_sqe* toyos_ring_get_sqe(struct toyos_ring* ring) {
+    // full until the kernel has consumed the oldest submission
+    if (ring->sq_tail - ring->sq_head >= TOYOS_RING_ENTRIES) {
+        return 0;
+    }
+
+    return &ring->sqes[ring->sq_tail % TOYOS_RING_ENTRIES];
+}
+
+void toyos_ring_queue(struct toyos_ring* ring) {
+    // the entry must be complete before the kernel can see it
+    __sync_synchronize();
+    ring->sq_tail++;
+}
+
+struct ring_cqe* toyos_ring_peek_cqe(struct toyos_ring* ring) {
+    if (ring->cq_head == ring->cq_tail) {
+        return 0;
+    }
+
+    return &ring->cqes[ring->cq_head % TOYOS_RING_ENTRIES];
+}
+
+void toyos_ring_cqe_seen(struct toyos_ring* ring) {
+    ring->cq_head++;
+}
+
+int toyos_getpid(void) {
+    return vvar->pid;
+}
+
+int toyos_get_process_count(void) {
+    return vvar->process_count;
+}
+
+uint64_t toyos_get_ticks(void) {
+    // retry if the kernel updated the page while it was read, or is updating it
+    uint32_t sequence;
+    uint64_t ticks;
     do {
-        // this "delay" is necessary to stay in user land
-        // so when the child process finishes we can return
-        // to the parent process
-        for (int i = 0; i < 2000000; i++) {
-            asm volatile("nop");
-        }
+        sequence = vvar->sequence;
+        __sync_synchronize();
+        ticks = vvar->ticks;
+        __sync_synchronize();
+    } while ((sequence & 1) || sequence != vvar->sequence);
 
-        if (toyos_check_done() == 0) {
-            break;
-        }
-    } while(1);
+    return ticks;
+}
+
+uint32_t toyos_get_uptime_ms(void) {
+    // split the period so only 32-bit arithmetic is needed, there is no 64-bit division in user land
+    uint32_t ticks = (uint32_t)toyos_get_ticks();
+    uint32_t period = vvar->timer_period_us;
+    return ticks * (period / 1000) + ticks * (period % 1000) / 1000;
 }
@@ -5,7 +5,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#define TOYOS_MAX_PROCESSES 12
+#define TOYOS_MAX_SPINLOCKS 32
+
+/* Console file descriptors for toyos_write */
+#define TOYOS_STDOUT 1
+#define TOYOS_STDERR 2
+
+/* Flags for toyos_disk_read */
+#define TOYOS_DISK_READ_PIO 0x1
 
 /* Socket type constant */
 #define SOCK_DGRAM 2
@@ -36,6 +43,64 @@ struct process_info {
     char filename[64];
 };
 
+struct process_stats_info {
+    int id;
+    char filename[64];
+    uint64_t runtime_cycles;
+    uint32_t context_switches;
+    uint32_t syscalls;
+    uint32_t resident_bytes;
+};
+
+struct irq_latency_stats {
+    uint64_t min_tick_cycles;
+    uint64_t max_tick_cycles;
+    uint64_t max_syscall_cycles;
+    uint32_t max_syscall;
+    uint32_t ticks;
+};
+
+struct bcache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t writebacks;
+    uint32_t dirty;
+    uint32_t buffers;
+};
+
+struct file_statfs {
+    uint32_t cluster_size;
+    uint32_t total_clusters;
+    uint32_t free_clusters;
+};
+
+struct spinlock_stats {
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint32_t spins;
+    uint64_t max_hold_cycles;
+};
+
+struct spinlock_info {
+    char name[16];
+    struct spinlock_stats stats;
+};
+
+/*
+ * Call count and latency histogram of one system call. Bucket i counts
+ * calls of 2^(i + 8) to 2^(i + 9) cycles, the first and last buckets
+ * also hold the faster and slower calls.
+ */
+#define TOYOS_SYSCALL_STATS_MAX 32
+#define TOYOS_SYSCALL_HISTOGRAM_BUCKETS 16
+#define TOYOS_SYSCALL_HISTOGRAM_SHIFT 8
+
+struct syscall_stats {
+    uint64_t total_cycles;
+    uint32_t calls;
+    uint32_t histogram[TOYOS_SYSCALL_HISTOGRAM_BUCKETS];
+};
+
 struct command_argument {
     char argument[512];
     struct command_argument *next;
@@ -46,6 +111,71 @@ struct process_arguments {
     char **argv;
 };
 
+/*
+ * Submission and completion rings shared with the kernel.
+ *
+ * Operations are queued on the submission ring and run by the kernel
+ * when toyos_ring_enter() is called, or at timer ticks when the rings
+ * were set up with RING_SETUP_POLL. Results arrive on the completion
+ * ring. These match the kernel-side definitions in sys/ring/ring.h.
+ */
+#define TOYOS_RING_ENTRIES 32
+#define RING_SETUP_POLL 0x01
+
+enum RING_OPS {
+    RING_OP_NOP,
+    RING_OP_PUTCHAR,  /* character in len */
+    RING_OP_GETKEY,   /* key in res, 0 if none */
+    RING_OP_SENDTO,   /* len bytes of buf on fd to ip:port */
+    RING_OP_RECVFROM, /* up to len bytes into buf from fd, sender in the completion */
+};
+
+struct ring_sqe {
+    uint32_t opcode;
+    int32_t fd;
+    void *buf;
+    int32_t len;
+    uint8_t ip[4];
+    uint16_t port;
+    uint16_t reserved;
+    uint32_t user_data;
+};
+
+struct ring_cqe {
+    uint32_t user_data;
+    int32_t res;
+    uint8_t ip[4];
+    uint16_t port;
+    uint16_t reserved;
+};
+
+/*
+ * Read-only kernel data mapped into every process at TOYOS_VVAR_ADDRESS.
+ * Read it through the accessors below, which retry while the kernel is
+ * updating it. This matches the kernel-side definition in task/vvar.h.
+ */
+#define TOYOS_VVAR_ADDRESS 0x3ff000
+
+struct toyos_vvar {
+    volatile uint32_t sequence;
+    volatile uint32_t pid;
+    volatile uint32_t process_count;
+    uint32_t timer_period_us;
+    volatile uint64_t ticks;
+    volatile uint64_t tsc_at_tick;
+};
+
+struct toyos_ring {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t entries;
+    uint32_t flags;
+    struct ring_sqe sqes[TOYOS_RING_ENTRIES];
+    struct ring_cqe cqes[TOYOS_RING_ENTRIES];
+};
+
 void print(const char *filename);
 int toyos_getkey(void);
 void *toyos_malloc(size_t size);
@@ -65,6 +195,28 @@ void *toyos_get_processes(void);
 void toyos_wait(void);
 void toyos_done(void);
 void toyos_kill(int pid);
+struct spinlock_info *toyos_get_lock_stats(void);
+struct process_stats_info *toyos_get_process_stats(void);
+struct irq_latency_stats *toyos_get_irq_latency(void);
+struct syscall_stats *toyos_get_syscall_stats(int pid);
+int toyos_write(int fd, const void *buf, size_t len);
+int toyos_disk_read(int disk, unsigned int lba, int total, void *buf, int flags);
+struct bcache_stats *toyos_get_bcache_stats(void);
+int toyos_sync(int disk);
+struct file_statfs *toyos_statfs(int disk);
+void toyos_null_syscall(void);
+struct toyos_ring *toyos_ring_setup(int flags);
+int toyos_ring_enter(void);
+struct ring_sqe *toyos_ring_get_sqe(struct toyos_ring *ring);
+void toyos_ring_queue(struct toyos_ring *ring);
+struct ring_cqe *toyos_ring_peek_cqe(struct toyos_ring *ring);
+void toyos_ring_cqe_seen(struct toyos_ring *ring);
+int toyos_getpid(void);
+int toyos_get_process_count(void);
+uint64_t toyos_get_ticks(void);
+uint32_t toyos_get_uptime_ms(void);
+void toyos_null_syscall_int80(void);
+uint64_t toyos_read_tsc(void);
 
 /* Network socket functions */
 int toyos_socket(int type);
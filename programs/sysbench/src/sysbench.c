@@ -0,0 +1,33 @@
+#include "sysbench.h"
+#include "stdio.h"
+#include "toyos.h"
+
+// round trips measured per entry path, as a power of two since there is no 64-bit division in user land
+#define SYSBENCH_ITERATIONS_SHIFT 16
+
+// average cycles for one null system call made through the given wrapper
+static uint32_t sysbench_run(void (*syscall)(void)) {
+    uint64_t start = toyos_read_tsc();
+    for (int i = 0; i < (1 << SYSBENCH_ITERATIONS_SHIFT); i++) {
+        syscall();
+    }
+
+    uint64_t cycles = toyos_read_tsc() - start;
+    return (uint32_t)(cycles >> SYSBENCH_ITERATIONS_SHIFT);
+}
+
+int main(int argc, char** argv) {
+    printf("sysbench - null system call round trip, %i calls each\n", 1 << SYSBENCH_ITERATIONS_SHIFT);
+
+    // warm up the caches and the SYSENTER detection before measuring
+    toyos_null_syscall();
+    toyos_null_syscall_int80();
+
+    uint32_t int80 = sysbench_run(toyos_null_syscall_int80);
+    uint32_t fast = sysbench_run(toyos_null_syscall);
+
+    printf("int 0x80: %i cycles\n", int80);
+    printf("sysenter: %i cycles\n", fast);
+
+    return 0;
+}
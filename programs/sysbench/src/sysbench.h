@@ -0,0 +1,4 @@
+#ifndef _SYSBENCH_H
+#define _SYSBENCH_H
+
+#endif
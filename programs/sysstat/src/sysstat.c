@@ -0,0 +1,199 @@
+#include "sysstat.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "toyos.h"
+
+// disks asked for their file system status, the kernel registers at most this many
+#define SYSSTAT_MAX_DISKS 8
+
+// names of the system calls, indexed by number
+static const char* syscall_names[] = {
+    "test",       "print",       "getkey",       "putchar",    "malloc",      "free",
+    "load",       "exit",        "getargs",      "system",     "clear",       "processes",
+    "checkdone",  "done",        "fork",         "kill",       "socket",      "bind",
+    "sendto",     "recvfrom",    "lockstats",    "procstats",  "irqlatency",  "null",
+    "ringsetup",  "ringenter",   "syscallstats", "write",     "diskread",    "bcachestats",
+    "sync",       "statfs",
+};
+
+// print a string followed by spaces up to the given width
+static void print_padded(const char* str, int width) {
+    printf("%s", str);
+    for (int i = strlen(str); i < width; i++) {
+        putchar(' ');
+    }
+}
+
+// total / count without 64-bit division, which user land does not have
+static uint32_t average(uint64_t total, uint32_t count) {
+    int shift = 0;
+    while ((total >> shift) > 0xffffffff) {
+        shift++;
+    }
+
+    return ((uint32_t)(total >> shift) / count) << shift;
+}
+
+// one digit per histogram bucket, the share of calls in it from 1 (some) to 9 (all)
+static void print_histogram(struct syscall_stats* stats) {
+    for (int i = 0; i < TOYOS_SYSCALL_HISTOGRAM_BUCKETS; i++) {
+        uint32_t count = stats->histogram[i];
+        if (!count) {
+            putchar('.');
+            continue;
+        }
+
+        // scale without overflowing 32 bits
+        uint32_t share = stats->calls < 0x10000000 ? count * 8 / stats->calls : count / (stats->calls / 8);
+        putchar('1' + (share > 8 ? 8 : share));
+    }
+}
+
+static int sysstat_syscalls(int pid) {
+    struct syscall_stats* stats = toyos_get_syscall_stats(pid);
+    if ((int)stats <= 0) {
+        printf("sysstat: no statistics for process %i\n\n", pid);
+        return -1;
+    }
+
+    print_padded("NR", 4);
+    print_padded("NAME", 14);
+    print_padded("CALLS", 10);
+    print_padded("AVG CYC", 10);
+    printf("LATENCY 2^%i.. CYCLES\n", TOYOS_SYSCALL_HISTOGRAM_SHIFT);
+
+    for (int i = 0; i < TOYOS_SYSCALL_STATS_MAX; i++) {
+        if (!stats[i].calls) {
+            continue;
+        }
+
+        int known = i < (int)(sizeof(syscall_names) / sizeof(syscall_names[0]));
+        print_padded(itoa(i), 4);
+        print_padded(known ? syscall_names[i] : "?", 14);
+        print_padded(itoa(stats[i].calls), 10);
+        print_padded(itoa(average(stats[i].total_cycles, stats[i].calls)), 10);
+        print_histogram(&stats[i]);
+        putchar('\n');
+    }
+
+    toyos_free(stats);
+    return 0;
+}
+
+static int sysstat_locks(void) {
+    struct spinlock_info* locks = toyos_get_lock_stats();
+    if ((int)locks <= 0) {
+        printf("sysstat: failed to read lock statistics\n\n");
+        return -1;
+    }
+
+    print_padded("LOCK", 18);
+    print_padded("ACQUIRED", 10);
+    print_padded("CONTENDED", 11);
+    print_padded("SPINS", 10);
+    printf("MAX HOLD KCYC\n");
+
+    for (int i = 0; i < TOYOS_MAX_SPINLOCKS && locks[i].name[0]; i++) {
+        print_padded(locks[i].name, 18);
+        print_padded(itoa(locks[i].stats.acquisitions), 10);
+        print_padded(itoa(locks[i].stats.contended), 11);
+        print_padded(itoa(locks[i].stats.spins), 10);
+        printf("%i\n", (int)(locks[i].stats.max_hold_cycles >> 10));
+    }
+
+    toyos_free(locks);
+    return 0;
+}
+
+static int sysstat_cache(void) {
+    struct bcache_stats* stats = toyos_get_bcache_stats();
+    if ((int)stats <= 0) {
+        printf("sysstat: failed to read buffer cache statistics\n\n");
+        return -1;
+    }
+
+    // scale without overflowing 32 bits
+    uint32_t accesses = stats->hits + stats->misses;
+    uint32_t hit_rate = 0;
+    if (accesses) {
+        hit_rate = accesses < 0x01000000 ? stats->hits * 100 / accesses : stats->hits / (accesses / 100);
+    }
+
+    print_padded("BUFFERS", 10);
+    print_padded("HITS", 10);
+    print_padded("MISSES", 10);
+    print_padded("HIT %", 8);
+    print_padded("WRITEBACKS", 12);
+    printf("DIRTY\n");
+
+    print_padded(itoa(stats->buffers), 10);
+    print_padded(itoa(stats->hits), 10);
+    print_padded(itoa(stats->misses), 10);
+    print_padded(itoa(hit_rate), 8);
+    print_padded(itoa(stats->writebacks), 12);
+    printf("%i\n", stats->dirty);
+
+    toyos_free(stats);
+    return 0;
+}
+
+static int sysstat_disks(void) {
+    print_padded("DISK", 6);
+    print_padded("CLUSTER", 10);
+    print_padded("TOTAL KB", 12);
+    printf("FREE KB\n");
+
+    // disks without a file system are skipped
+    for (int disk = 0; disk < SYSSTAT_MAX_DISKS; disk++) {
+        struct file_statfs* stat = toyos_statfs(disk);
+        if ((int)stat <= 0) {
+            continue;
+        }
+
+        uint32_t cluster_kb = stat->cluster_size / 1024;
+        print_padded(itoa(disk), 6);
+        print_padded(itoa(stat->cluster_size), 10);
+        if (cluster_kb) {
+            print_padded(itoa(stat->total_clusters * cluster_kb), 12);
+            printf("%i\n", stat->free_clusters * cluster_kb);
+        } else {
+            print_padded(itoa(stat->total_clusters / (1024 / stat->cluster_size)), 12);
+            printf("%i\n", stat->free_clusters / (1024 / stat->cluster_size));
+        }
+
+        toyos_free(stat);
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return sysstat_syscalls(-1);
+    }
+
+    if (strncmp(argv[1], "locks", 5) == 0) {
+        return sysstat_locks();
+    }
+
+    if (strncmp(argv[1], "cache", 5) == 0) {
+        return sysstat_cache();
+    }
+
+    if (strncmp(argv[1], "disks", 5) == 0) {
+        return sysstat_disks();
+    }
+
+    int pid = 0;
+    for (const char* c = argv[1]; *c; c++) {
+        if (!is_digit(*c)) {
+            printf("Usage: sysstat [ process id | locks | cache | disks ]\n\n");
+            return -1;
+        }
+
+        pid = pid * 10 + ctoi(*c);
+    }
+
+    return sysstat_syscalls(pid);
+}
@@ -0,0 +1,4 @@
+#ifndef _SYSSTAT_H
+#define _SYSSTAT_H
+
+#endif
\ No newline at end of file
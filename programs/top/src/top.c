@@ -0,0 +1,111 @@
+#include "top.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "toyos.h"
+
+// busy-wait iterations between two refreshes
+#define TOP_REFRESH_DELAY 20000000
+
+// cycle counts are scaled down before dividing, there is no 64-bit division in user land
+#define TOP_CYCLE_SHIFT 16
+
+// print a string followed by spaces up to the given width
+static void print_padded(const char* str, int width) {
+    printf("%s", str);
+    for (int i = strlen(str); i < width; i++) {
+        putchar(' ');
+    }
+}
+
+// runtime of a process in the previous sample, or 0 if it did not exist yet
+static uint64_t previous_runtime(struct process_stats_info* previous, int id) {
+    if (!previous) {
+        return 0;
+    }
+
+    for (int i = 0; previous[i].id >= 0; i++) {
+        if (previous[i].id == id) {
+            return previous[i].runtime_cycles;
+        }
+    }
+
+    return 0;
+}
+
+static void top_print(struct process_stats_info* current, struct process_stats_info* previous) {
+    // the CPU share is relative to the time all processes ran since the previous sample
+    uint32_t total = 0;
+    for (int i = 0; current[i].id >= 0; i++) {
+        total += (current[i].runtime_cycles - previous_runtime(previous, current[i].id)) >> TOP_CYCLE_SHIFT;
+    }
+
+    toyos_clear_terminal();
+    // read from the shared kernel data page, without a system call
+    printf("top - up %i s, %i processes - press q to quit\n", toyos_get_uptime_ms() / 1000,
+           toyos_get_process_count());
+
+    // how late the timer ran at worst, and how long the longest system call took
+    struct irq_latency_stats* latency = toyos_get_irq_latency();
+    if (latency) {
+        uint32_t jitter = (uint32_t)((latency->max_tick_cycles - latency->min_tick_cycles) >> 10);
+        printf("irq latency: %i kcycles worst tick delay, longest syscall %i kcycles (syscall %i)\n",
+               jitter, (uint32_t)(latency->max_syscall_cycles >> 10), latency->max_syscall);
+        toyos_free(latency);
+    }
+
+    print("\n");
+    print_padded("PID", 6);
+    print_padded("PATH", 20);
+    print_padded("%CPU", 6);
+    print_padded("MCYCLES", 10);
+    print_padded("SWITCHES", 10);
+    print_padded("SYSCALLS", 10);
+    printf("RES(KB)\n");
+
+    for (int i = 0; current[i].id >= 0; i++) {
+        uint32_t delta = (current[i].runtime_cycles - previous_runtime(previous, current[i].id)) >> TOP_CYCLE_SHIFT;
+        int cpu = total ? (int)(delta * 100 / total) : 0;
+
+        print_padded(itoa(current[i].id), 6);
+        print_padded(current[i].filename, 20);
+        print_padded(itoa(cpu), 6);
+        print_padded(itoa((int)(current[i].runtime_cycles >> 20)), 10);
+        print_padded(itoa(current[i].context_switches), 10);
+        print_padded(itoa(current[i].syscalls), 10);
+        printf("%i\n", current[i].resident_bytes / 1024);
+    }
+}
+
+int main(int argc, char** argv) {
+    struct process_stats_info* previous = NULL;
+
+    while (1) {
+        struct process_stats_info* current = toyos_get_process_stats();
+        if (!current) {
+            printf("top: failed to read process statistics\n\n");
+            break;
+        }
+
+        top_print(current, previous);
+        if (previous) {
+            toyos_free(previous);
+        }
+
+        previous = current;
+
+        for (int i = 0; i < TOP_REFRESH_DELAY; i++) {
+            if ((i % 100000) == 0 && toyos_getkey() == 'q') {
+                goto done;
+            }
+        }
+    }
+
+done:
+    if (previous) {
+        toyos_free(previous);
+    }
+
+    print("\n");
+    return 0;
+}
@@ -0,0 +1,4 @@
+#ifndef _TOP_H
+#define _TOP_H
+
+#endif
\ No newline at end of file
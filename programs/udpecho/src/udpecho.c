@@ -9,8 +9,11 @@
  * Now the echo logic is here, in user space. It uses system calls to:
  *   1. Create a UDP socket         (toyos_socket)
  *   2. Bind to port 7              (toyos_bind)
- *   3. Receive packets             (toyos_recvfrom)
- *   4. Send them back              (toyos_sendto)
+ *   3. Receive packets             (RING_OP_RECVFROM)
+ *   4. Send them back              (RING_OP_SENDTO)
+ *
+ * Receives and sends are queued on the submission ring, so a single
+ * doorbell (toyos_ring_enter) runs a whole batch of them.
  *
  * The kernel's job is just to deliver packets to the right socket and
  * send them out — it doesn't know or care what the application does
@@ -30,6 +33,39 @@
 #define ECHO_PORT 7
 #define BUF_SIZE 1024
 
+/* number of receives kept queued, each with its own buffer */
+#define ECHO_SLOTS 8
+
+/* set in user_data for sends, the low bits hold the slot */
+#define ECHO_SEND 0x100
+
+static char buffers[ECHO_SLOTS][BUF_SIZE];
+
+static void queue_recvfrom(struct toyos_ring *ring, int sock, int slot) {
+    struct ring_sqe *sqe = toyos_ring_get_sqe(ring);
+    sqe->opcode = RING_OP_RECVFROM;
+    sqe->fd = sock;
+    sqe->buf = buffers[slot];
+    sqe->len = BUF_SIZE;
+    sqe->user_data = slot;
+    toyos_ring_queue(ring);
+}
+
+static void queue_sendto(struct toyos_ring *ring, int sock, int slot, struct ring_cqe *received) {
+    struct ring_sqe *sqe = toyos_ring_get_sqe(ring);
+    sqe->opcode = RING_OP_SENDTO;
+    sqe->fd = sock;
+    sqe->buf = buffers[slot];
+    sqe->len = received->res;
+    sqe->ip[0] = received->ip[0];
+    sqe->ip[1] = received->ip[1];
+    sqe->ip[2] = received->ip[2];
+    sqe->ip[3] = received->ip[3];
+    sqe->port = received->port;
+    sqe->user_data = slot | ECHO_SEND;
+    toyos_ring_queue(ring);
+}
+
 int main(int argc, char **argv) {
     print("UDP Echo Server starting on port 7...\n");
 
@@ -59,42 +95,49 @@ int main(int argc, char **argv) {
     print("  echo \"hello\" | nc -u -w1 10.0.2.15 7\n\n");
 
     /*
-     * Step 3: Main loop — receive and echo back.
+     * Step 3: Set up the submission and completion rings.
+     * The kernel maps them into our address space, so queueing an
+     * operation is just a memory write.
+     */
+    struct toyos_ring *ring = toyos_ring_setup(0);
+    if ((int)ring < 0) {
+        print("Failed to set up the rings!\n");
+        return 1;
+    }
+
+    /*
+     * Step 4: Main loop — receive and echo back.
      *
-     * recvfrom() is non-blocking: it returns 0 if no packet is
-     * available. So we poll in a loop. This is wasteful (burns CPU),
-     * but we don't have a sleep/wakeup mechanism yet.
+     * Each slot always has exactly one operation in flight: a receive
+     * into its buffer, or the send echoing it back. At most ECHO_SLOTS
+     * operations are queued, so the rings never overflow.
      *
-     * A real OS would use select(), poll(), or epoll() to block
-     * until data arrives. That requires the kernel to put the
-     * process to sleep and wake it on packet arrival.
+     * Receives are non-blocking: they complete with 0 if no packet is
+     * available, and are simply queued again. This still polls, but
+     * each doorbell now covers every slot instead of one trap per call.
      */
-    char buf[BUF_SIZE];
-    struct recvfrom_args recv_args;
-    recv_args.sockfd = sock;
-    recv_args.buf = buf;
-    recv_args.max_len = BUF_SIZE;
+    for (int slot = 0; slot < ECHO_SLOTS; slot++) {
+        queue_recvfrom(ring, sock, slot);
+    }
 
     while (1) {
-        int n = toyos_recvfrom(&recv_args);
-
-        if (n > 0) {
-            /*
-             * Got a packet! Echo it back to the sender.
-             * recv_args.src_ip and recv_args.src_port were filled
-             * by the kernel with the sender's address.
-             */
-            struct sendto_args send_args;
-            send_args.sockfd = sock;
-            send_args.buf = buf;
-            send_args.len = n;
-            send_args.dst_ip[0] = recv_args.src_ip[0];
-            send_args.dst_ip[1] = recv_args.src_ip[1];
-            send_args.dst_ip[2] = recv_args.src_ip[2];
-            send_args.dst_ip[3] = recv_args.src_ip[3];
-            send_args.dst_port = recv_args.src_port;
-
-            toyos_sendto(&send_args);
+        toyos_ring_enter();
+
+        struct ring_cqe *cqe;
+        while ((cqe = toyos_ring_peek_cqe(ring))) {
+            int slot = cqe->user_data & ~ECHO_SEND;
+            if (!(cqe->user_data & ECHO_SEND) && cqe->res > 0) {
+                /*
+                 * Got a packet! Echo it back to the sender, whose
+                 * address the kernel put in the completion.
+                 */
+                queue_sendto(ring, sock, slot, cqe);
+            } else {
+                /* the echo was sent, or nothing arrived: receive again */
+                queue_recvfrom(ring, sock, slot);
+            }
+
+            toyos_ring_cqe_seen(ring);
         }
     }
 
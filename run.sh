@@ -2,6 +2,7 @@
 
 # Run ToyOS in QEMU with TAP networking.
 # Run ./setup_tap.sh first to create the TAP interface.
+# Set VIRTIO_DISK to a raw image to attach it as a virtio-blk disk (1:/).
 
 TAP_DEV="tap0"
 
@@ -10,8 +11,14 @@ if ! ip link show "$TAP_DEV" &>/dev/null; then
     exit 1
 fi
 
+EXTRA_ARGS=()
+if [ -n "$VIRTIO_DISK" ]; then
+    EXTRA_ARGS+=(-drive file="$VIRTIO_DISK",if=virtio,format=raw)
+fi
+
 qemu-system-i386 \
     -hda ./bin/os.bin \
+    "${EXTRA_ARGS[@]}" \
     -netdev tap,id=net0,ifname="$TAP_DEV",script=no,downscript=no \
     -device rtl8139,netdev=net0 \
     -monitor stdio \
@@ -17,6 +17,7 @@
  * hardware and software interrupts.
  */
 #define TOYOS_TOTAL_INTERRUPTS 512 /**< Total number of interrupt vectors. */
+#define TOYOS_MAX_SHARED_IRQ_HANDLERS 4 /**< Maximum number of devices sharing a hardware interrupt line. */
 
 /**
  * @brief Configuration for the kernel heap.
@@ -45,6 +46,7 @@
  * and file system operations.
  */
 #define TOYOS_SECTOR_SIZE 512 /**< Size of a disk sector in bytes. */
+#define TOYOS_MAX_DISKS 8     /**< Maximum number of disks and partitions, addressed as 0:/ to 7:/. */
 
 /**
  * @brief Maximum configuration values for file systems and descriptors.
@@ -75,21 +77,60 @@
     (TOYOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - TOYOS_USER_PROGRAM_STACK_SIZE)
 #define TOYOS_USER_DATA_SEGMENT 0x23 /**< User data segment selector. */
 #define TOYOS_USER_CODE_SEGMENT 0x1b /**< User code segment selector. */
+#define TOYOS_KERNEL_STACK_SIZE (1024 * 16) /**< Size of the kernel stack given to each task. */
+#define TOYOS_VVAR_ADDRESS 0x3ff000          /**< Virtual address of the read-only shared kernel data page. */
 
 /**
  * @brief Configuration for process and program management.
  */
-#define TOYOS_MAX_PROGRAM_ALLOCATIONS 1024 /**< Maximum number of memory allocations per program. */
-#define TOYOS_MAX_PROCESSES 12             /**< Max number of processes > */
+#define TOYOS_MAX_PROGRAM_ALLOCATIONS 1024    /**< Maximum number of memory allocations per program. */
+#define TOYOS_INITIAL_PROGRAM_ALLOCATIONS 16 /**< Allocation slots reserved on a program's first allocation. */
+#define TOYOS_MAX_PROCESSES 1024             /**< Max number of processes (highest process ID + 1). */
+#define TOYOS_INITIAL_PROCESSES 16           /**< Initial size of the process table, doubled when full. */
+#define TOYOS_MAX_PROGRAM_ARGUMENTS 64       /**< Maximum number of arguments passed to a program. */
 
 /**
  * @brief Configuration for system calls.
  */
-#define TOYOS_MAX_SYSCALLS 1024 /**< Maximum number of system calls. */
+#define TOYOS_MAX_SYSCALLS 1024             /**< Maximum number of system calls. */
+#define TOYOS_SYSCALL_REGISTER_ABI 0x8000 /**< Set in EAX when arguments are passed in EBX, ECX, EDX, ESI, EDI. */
+#define TOYOS_SYSCALL_MAX_ARGUMENTS 5     /**< Number of arguments that can be passed in registers. */
+#define TOYOS_RING_ENTRIES 32             /**< Entries in each submission and completion ring. */
+#define TOYOS_SYSCALL_STATS_MAX 32        /**< System call numbers below this have their calls counted. */
+#define TOYOS_SYSCALL_HISTOGRAM_BUCKETS 16 /**< Latency histogram buckets, each twice as wide as the previous. */
+#define TOYOS_SYSCALL_HISTOGRAM_SHIFT 8   /**< The first bucket holds calls of up to 2^(SHIFT+1) cycles. */
 
 /**
  * @brief Configuration for the keyboard buffer.
  */
 #define TOYOS_KEYBOARD_BUFFER_SIZE 1024 /**< Size of the keyboard buffer. */
 
+/**
+ * @brief Configuration for lock statistics.
+ */
+#define TOYOS_MAX_SPINLOCKS 32 /**< Maximum number of spinlocks whose statistics are reported. */
+
+/**
+ * @brief Configuration for the buffer cache.
+ */
+#define TOYOS_BCACHE_BUFFERS 256      /**< Number of cached sectors. */
+#define TOYOS_BCACHE_HASH_SIZE 64     /**< Buckets of the lookup hash table, a power of two. */
+#define TOYOS_BCACHE_DIRTY_MAX 64     /**< Dirty sectors beyond which the cache is written back. */
+#define TOYOS_BCACHE_SYNC_TICKS 91    /**< Timer ticks (about 5 s) after which dirty sectors are written back. */
+
+/**
+ * @brief Configuration for the disk streamer.
+ */
+#define TOYOS_STREAMER_READAHEAD_SECTORS 16 /**< Sectors read ahead for sequential small reads (8 KB). */
+
+/**
+ * @brief Configuration for the RAM disk.
+ */
+#define TOYOS_RAMDISK_MAX_SECTORS 40960 /**< Largest boot disk copied into a RAM disk (20 MB), 0 disables it. */
+
+/**
+ * @brief Configuration for the timer.
+ */
+#define TOYOS_TIMER_PERIOD_US 54925 /**< Timer tick interval, the PIT default of 65536 / 1193182 Hz. */
+
 #endif
@@ -0,0 +1,126 @@
+; This file, cpu.asm, provides access to CPU state that cannot be expressed in C:
+; the time stamp counter, the interrupt flag in EFLAGS, CPUID, and the control
+; register bits and instructions used to manage the FPU/SSE register file.
+
+section .asm
+
+global cpu_read_tsc       ; Make the cpu_read_tsc function accessible from other files.
+global cpu_irq_save       ; Make the cpu_irq_save function accessible from other files.
+global cpu_irq_restore    ; Make the cpu_irq_restore function accessible from other files.
+global cpu_read_eflags    ; Make the cpu_read_eflags function accessible from other files.
+global cpu_cpuid_edx      ; Make the cpu_cpuid_edx function accessible from other files.
+global cpu_enable_sse     ; Make the cpu_enable_sse function accessible from other files.
+global cpu_set_ts         ; Make the cpu_set_ts function accessible from other files.
+global cpu_clear_ts       ; Make the cpu_clear_ts function accessible from other files.
+global cpu_fpu_reset      ; Make the cpu_fpu_reset function accessible from other files.
+global cpu_fxsave         ; Make the cpu_fxsave function accessible from other files.
+global cpu_fxrstor        ; Make the cpu_fxrstor function accessible from other files.
+global cpu_write_msr      ; Make the cpu_write_msr function accessible from other files.
+
+; Function: cpu_read_tsc
+; Description: Reads the 64-bit time stamp counter.
+; Returns: The counter value in EDX:EAX (the cdecl convention for uint64_t).
+cpu_read_tsc:
+    rdtsc                 ; Load the time stamp counter into EDX:EAX.
+    ret                   ; Return, with the result in EDX:EAX.
+
+; Function: cpu_irq_save
+; Description: Saves EFLAGS and disables hardware interrupts.
+; Returns: The EFLAGS value from before interrupts were disabled (in EAX).
+cpu_irq_save:
+    pushfd                ; Push EFLAGS onto the stack.
+    pop eax               ; Pop EFLAGS into EAX so it can be returned.
+    cli                   ; Clear Interrupt Flag (IF) to disable hardware interrupts.
+    ret                   ; Return, with the saved flags in EAX.
+
+; Function: cpu_read_eflags
+; Description: Reads EFLAGS without changing it.
+; Returns: The current EFLAGS value (in EAX).
+cpu_read_eflags:
+    pushfd                ; Push EFLAGS onto the stack.
+    pop eax               ; Pop EFLAGS into EAX so it can be returned.
+    ret                   ; Return, with the flags in EAX.
+
+; Function: cpu_irq_restore
+; Description: Restores EFLAGS previously returned by cpu_irq_save.
+; Parameters: flags - The EFLAGS value to restore.
+cpu_irq_restore:
+    push dword [esp+4]    ; Push the saved flags argument.
+    popfd                 ; Restore EFLAGS, re-enabling interrupts if IF was set.
+    ret                   ; Return.
+
+; Function: cpu_cpuid_edx
+; Description: Executes CPUID for the given leaf and returns the feature bits in EDX.
+; Parameters: leaf - The CPUID leaf (EAX input).
+; Returns: The value of EDX after CPUID (in EAX).
+cpu_cpuid_edx:
+    push ebx              ; CPUID clobbers EBX, which is callee-saved.
+    mov eax, [esp+8]      ; Load the leaf from the stack into EAX.
+    xor ecx, ecx          ; Use sub-leaf 0.
+    cpuid                 ; Query the processor.
+    mov eax, edx          ; Return the feature bits from EDX.
+    pop ebx               ; Restore EBX.
+    ret                   ; Return, with the result in EAX.
+
+; Function: cpu_enable_sse
+; Description: Enables the FPU and SSE for both kernel and user code.
+; Clears CR0.EM (no emulation), sets CR0.MP and CR0.NE (native FPU errors), and sets
+; CR4.OSFXSR and CR4.OSXMMEXCPT so FXSAVE/FXRSTOR and SSE exceptions are supported.
+cpu_enable_sse:
+    mov eax, cr0          ; Load the current value of CR0.
+    and eax, ~0x04        ; Clear EM (bit 2).
+    or eax, 0x22          ; Set MP (bit 1) and NE (bit 5).
+    mov cr0, eax          ; Store the updated value back into CR0.
+    mov eax, cr4          ; Load the current value of CR4.
+    or eax, 0x600         ; Set OSFXSR (bit 9) and OSXMMEXCPT (bit 10).
+    mov cr4, eax          ; Store the updated value back into CR4.
+    ret                   ; Return.
+
+; Function: cpu_set_ts
+; Description: Sets CR0.TS so the next FPU/SSE instruction raises #NM (interrupt 7).
+cpu_set_ts:
+    mov eax, cr0          ; Load the current value of CR0.
+    or eax, 0x08          ; Set TS (bit 3).
+    mov cr0, eax          ; Store the updated value back into CR0.
+    ret                   ; Return.
+
+; Function: cpu_clear_ts
+; Description: Clears CR0.TS so FPU/SSE instructions execute without faulting.
+cpu_clear_ts:
+    clts                  ; Clear the task switched flag.
+    ret                   ; Return.
+
+; Function: cpu_fpu_reset
+; Description: Puts the FPU and SSE unit into their power-on default state.
+cpu_fpu_reset:
+    fninit                ; Reset the x87 FPU.
+    push dword 0x1f80     ; Default MXCSR: all SSE exceptions masked, round to nearest.
+    ldmxcsr [esp]         ; Load the default MXCSR.
+    add esp, 4            ; Clean up the stack.
+    ret                   ; Return.
+
+; Function: cpu_fxsave
+; Description: Saves the FPU, MMX and SSE registers.
+; Parameters: area - Pointer to a 512-byte, 16-byte aligned save area.
+cpu_fxsave:
+    mov eax, [esp+4]      ; Load the save area pointer.
+    fxsave [eax]          ; Save the register file.
+    ret                   ; Return.
+
+; Function: cpu_fxrstor
+; Description: Restores the FPU, MMX and SSE registers.
+; Parameters: area - Pointer to a 512-byte, 16-byte aligned save area.
+cpu_fxrstor:
+    mov eax, [esp+4]      ; Load the save area pointer.
+    fxrstor [eax]         ; Restore the register file.
+    ret                   ; Return.
+
+; Function: cpu_write_msr
+; Description: Writes a model specific register.
+; Parameters: msr - The register number, value - The 64-bit value to write.
+cpu_write_msr:
+    mov ecx, [esp+4]      ; Load the register number.
+    mov eax, [esp+8]      ; Load the low 32 bits of the value.
+    mov edx, [esp+12]     ; Load the high 32 bits of the value.
+    wrmsr                 ; Write EDX:EAX to the register.
+    ret                   ; Return.
\ No newline at end of file
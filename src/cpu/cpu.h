@@ -0,0 +1,108 @@
+#ifndef _CPU_H_
+#define _CPU_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Interrupt flag (IF) bit in EFLAGS.
+ */
+#define CPU_EFLAGS_IF 0x200
+
+/**
+ * @brief Reads the CPU time stamp counter.
+ *
+ * The counter increments once per clock cycle and is used to measure elapsed time
+ * without programming a hardware timer.
+ *
+ * @return The current value of the time stamp counter.
+ */
+uint64_t cpu_read_tsc(void);
+
+/**
+ * @brief Reads the EFLAGS register.
+ *
+ * @return The current EFLAGS value.
+ */
+uint32_t cpu_read_eflags(void);
+
+/**
+ * @brief Saves EFLAGS and disables hardware interrupts.
+ *
+ * @return The EFLAGS value from before interrupts were disabled.
+ */
+uint32_t cpu_irq_save(void);
+
+/**
+ * @brief Restores EFLAGS previously saved by cpu_irq_save().
+ *
+ * Interrupts are re-enabled only if they were enabled when the flags were saved.
+ *
+ * @param flags The saved EFLAGS value.
+ */
+void cpu_irq_restore(uint32_t flags);
+
+/**
+ * @brief CPUID leaf 1 EDX feature bits.
+ */
+#define CPU_FEATURE_SEP (1 << 11)  /**< SYSENTER/SYSEXIT supported. */
+#define CPU_FEATURE_FXSR (1 << 24) /**< FXSAVE/FXRSTOR supported. */
+#define CPU_FEATURE_SSE (1 << 25)  /**< SSE supported. */
+
+/**
+ * @brief Executes CPUID and returns the EDX feature bits.
+ *
+ * @param leaf The CPUID leaf.
+ * @return The value of EDX.
+ */
+uint32_t cpu_cpuid_edx(uint32_t leaf);
+
+/**
+ * @brief Enables the FPU and SSE (CR0.EM cleared, CR0.MP/NE and CR4.OSFXSR/OSXMMEXCPT set).
+ */
+void cpu_enable_sse(void);
+
+/**
+ * @brief Sets CR0.TS so the next FPU/SSE instruction raises a device-not-available (#NM) fault.
+ */
+void cpu_set_ts(void);
+
+/**
+ * @brief Clears CR0.TS.
+ */
+void cpu_clear_ts(void);
+
+/**
+ * @brief Resets the FPU and MXCSR to their default state.
+ */
+void cpu_fpu_reset(void);
+
+/**
+ * @brief Saves the FPU/SSE registers with FXSAVE.
+ *
+ * @param area A 512-byte, 16-byte aligned save area.
+ */
+void cpu_fxsave(void *area);
+
+/**
+ * @brief Restores the FPU/SSE registers with FXRSTOR.
+ *
+ * @param area A 512-byte, 16-byte aligned save area.
+ */
+void cpu_fxrstor(void *area);
+
+/**
+ * @brief Model specific registers used to configure SYSENTER.
+ */
+#define CPU_MSR_SYSENTER_CS 0x174  /**< Kernel code selector loaded by SYSENTER. */
+#define CPU_MSR_SYSENTER_ESP 0x175 /**< Stack pointer loaded by SYSENTER. */
+#define CPU_MSR_SYSENTER_EIP 0x176 /**< Entry point jumped to by SYSENTER. */
+
+/**
+ * @brief Writes a model specific register with WRMSR.
+ *
+ * @param msr The register number.
+ * @param value The value to write.
+ */
+void cpu_write_msr(uint32_t msr, uint64_t value);
+
+#endif
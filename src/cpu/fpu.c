@@ -0,0 +1,105 @@
+#include "fpu.h"
+#include "cpu.h"
+#include "idt/idt.h"
+#include "kernel.h"
+#include "memory/memory.h"
+#include "task/process.h"
+#include "task/task.h"
+
+// Whether the CPU supports FXSAVE/FXRSTOR and SSE
+static bool fpu_available = false;
+
+// The task whose state is currently loaded in the FPU registers
+static struct task *fpu_owner = NULL;
+
+/**
+ * @brief Handles the device-not-available exception (interrupt 7)
+ *
+ * Raised by the first FPU/SSE instruction a task executes while CR0.TS is set. Saves the
+ * registers of the previous owner, loads the registers of the current task and returns to
+ * the faulting instruction.
+ */
+static void fpu_handle_nm(void) {
+    struct task *task = task_current();
+    if (!fpu_available) {
+        process_terminate(task->process);
+        task_next();
+    }
+
+    cpu_clear_ts();
+    if (fpu_owner == task) {
+        return;
+    }
+
+    if (fpu_owner) {
+        cpu_fxsave(fpu_owner->fpu.fxsave_area);
+    }
+
+    if (task->fpu_used) {
+        cpu_fxrstor(task->fpu.fxsave_area);
+    } else {
+        cpu_fpu_reset();
+        task->fpu_used = true;
+    }
+
+    fpu_owner = task;
+}
+
+void fpu_init(void) {
+    uint32_t features = cpu_cpuid_edx(1);
+    if (!(features & CPU_FEATURE_FXSR) || !(features & CPU_FEATURE_SSE)) {
+        alertk("FXSR/SSE not supported, FPU disabled\n");
+    } else {
+        cpu_enable_sse();
+        cpu_fpu_reset();
+        fpu_available = true;
+    }
+
+    // Nothing owns the registers yet, so the first FPU instruction of any task faults
+    cpu_set_ts();
+    idt_register_interrupt_callback(7, fpu_handle_nm);
+}
+
+void fpu_task_switch(struct task *task) {
+    if (task == fpu_owner) {
+        cpu_clear_ts();
+    } else {
+        cpu_set_ts();
+    }
+}
+
+void fpu_task_copy(struct task *dest, struct task *src) {
+    if (!src->fpu_used) {
+        return;
+    }
+
+    if (src == fpu_owner) {
+        cpu_clear_ts();
+        cpu_fxsave(src->fpu.fxsave_area);
+        fpu_task_switch(task_current());
+    }
+
+    memcpy(&dest->fpu, &src->fpu, sizeof(struct fpu_state));
+    dest->fpu_used = true;
+}
+
+void fpu_task_free(struct task *task) {
+    if (task == fpu_owner) {
+        fpu_owner = NULL;
+    }
+}
+
+void fpu_kernel_begin(void) {
+    preempt_disable();
+    cpu_clear_ts();
+    if (fpu_owner) {
+        cpu_fxsave(fpu_owner->fpu.fxsave_area);
+        fpu_owner = NULL;
+    }
+}
+
+void fpu_kernel_end(void) {
+    // The owner was saved in fpu_kernel_begin(), so the next task to use the FPU reloads it
+    cpu_set_ts();
+    preempt_enable();
+}
@@ -0,0 +1,70 @@
+#ifndef _FPU_H_
+#define _FPU_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Size of the FXSAVE area in bytes.
+ */
+#define FPU_STATE_SIZE 512
+
+/**
+ * @brief Saved FPU, MMX and SSE register file of a task
+ *
+ * FXSAVE/FXRSTOR require the area to be 16-byte aligned.
+ */
+struct fpu_state {
+    uint8_t fxsave_area[FPU_STATE_SIZE];
+} __attribute__((aligned(16)));
+
+/**
+ * Forward declaration of the task structure.
+ */
+struct task;
+
+/**
+ * @brief Enables the FPU and SSE and installs the device-not-available (#NM) handler
+ *
+ * FPU state is switched lazily: CR0.TS is set whenever a task that does not own the FPU
+ * registers is scheduled, and the registers are only saved and restored when that task
+ * actually executes an FPU/SSE instruction.
+ */
+void fpu_init(void);
+
+/**
+ * @brief Updates CR0.TS for the task that is about to run
+ *
+ * @param task The task being switched to.
+ */
+void fpu_task_switch(struct task *task);
+
+/**
+ * @brief Copies the FPU state of one task into another, e.g. on fork
+ *
+ * @param dest The task receiving the state.
+ * @param src The task whose state is copied.
+ */
+void fpu_task_copy(struct task *dest, struct task *src);
+
+/**
+ * @brief Releases the FPU registers if they are owned by a task being freed
+ *
+ * @param task The task being freed.
+ */
+void fpu_task_free(struct task *task);
+
+/**
+ * @brief Allows the kernel to use FPU/SSE instructions
+ *
+ * Saves the registers of the task that owns the FPU so the kernel can clobber them and disables
+ * preemption. Must be paired with fpu_kernel_end().
+ */
+void fpu_kernel_begin(void);
+
+/**
+ * @brief Ends a kernel FPU/SSE section started with fpu_kernel_begin()
+ */
+void fpu_kernel_end(void);
+
+#endif
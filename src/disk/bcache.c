@@ -0,0 +1,422 @@
+#include "bcache.h"
+#include "config.h"
+#include "disk.h"
+#include "locks/mutex.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+#include "ramdisk.h"
+#include "status.h"
+#include "task/vvar.h"
+#include <stdbool.h>
+
+/**
+ * @brief A cached sector.
+ *
+ * The data comes first so that it is word aligned and can be transferred by DMA directly.
+ */
+struct bcache_buffer {
+    char data[TOYOS_SECTOR_SIZE];
+    struct disk *disk;                /**< Disk the sector belongs to, or NULL if the buffer is unused. */
+    unsigned int lba;                 /**< The cached sector. */
+    bool dirty;                       /**< The data has not been written to the disk yet. */
+    struct bcache_buffer *hash_next;  /**< Next buffer in the same hash bucket. */
+    struct bcache_buffer *lru_prev;   /**< More recently used neighbour. */
+    struct bcache_buffer *lru_next;   /**< Less recently used neighbour. */
+};
+
+static struct bcache_buffer *buffers = NULL;
+static struct bcache_buffer *hash_table[TOYOS_BCACHE_HASH_SIZE];
+static struct bcache_buffer *lru_head = NULL;  // Most recently used
+static struct bcache_buffer *lru_tail = NULL;  // Least recently used, the next to be reused
+static struct bcache_stats stats;
+static uint32_t last_sync_tick = 0;
+
+// Held across disk I/O, so waiting for a transfer can let other tasks run
+static struct mutex bcache_lock = MUTEX_INIT;
+
+/**
+ * @brief Returns the hash bucket of a sector.
+ */
+static struct bcache_buffer **bcache_bucket(struct disk *disk, unsigned int lba) {
+    return &hash_table[(lba ^ ((unsigned int)disk->id << 5)) & (TOYOS_BCACHE_HASH_SIZE - 1)];
+}
+
+/**
+ * @brief Finds the buffer caching a sector.
+ *
+ * @return The buffer, or NULL if the sector is not cached.
+ */
+static struct bcache_buffer *bcache_lookup(struct disk *disk, unsigned int lba) {
+    for (struct bcache_buffer *buf = *bcache_bucket(disk, lba); buf; buf = buf->hash_next) {
+        if (buf->disk == disk && buf->lba == lba) {
+            return buf;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Removes a buffer from its hash bucket.
+ */
+static void bcache_unhash(struct bcache_buffer *buf) {
+    struct bcache_buffer **link = bcache_bucket(buf->disk, buf->lba);
+    while (*link && *link != buf) {
+        link = &(*link)->hash_next;
+    }
+
+    if (*link) {
+        *link = buf->hash_next;
+    }
+
+    buf->hash_next = NULL;
+    buf->disk = NULL;
+}
+
+/**
+ * @brief Removes a buffer from the LRU list.
+ */
+static void bcache_lru_remove(struct bcache_buffer *buf) {
+    if (buf->lru_prev) {
+        buf->lru_prev->lru_next = buf->lru_next;
+    } else {
+        lru_head = buf->lru_next;
+    }
+
+    if (buf->lru_next) {
+        buf->lru_next->lru_prev = buf->lru_prev;
+    } else {
+        lru_tail = buf->lru_prev;
+    }
+
+    buf->lru_prev = NULL;
+    buf->lru_next = NULL;
+}
+
+/**
+ * @brief Makes a buffer the most recently used.
+ */
+static void bcache_lru_touch(struct bcache_buffer *buf) {
+    bcache_lru_remove(buf);
+    buf->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = buf;
+    }
+
+    lru_head = buf;
+    if (!lru_tail) {
+        lru_tail = buf;
+    }
+}
+
+/**
+ * @brief Makes a buffer the least recently used, so it is reused first.
+ */
+static void bcache_lru_discard(struct bcache_buffer *buf) {
+    bcache_lru_remove(buf);
+    buf->lru_prev = lru_tail;
+    if (lru_tail) {
+        lru_tail->lru_next = buf;
+    }
+
+    lru_tail = buf;
+    if (!lru_head) {
+        lru_head = buf;
+    }
+}
+
+/**
+ * @brief Writes a dirty buffer to the disk.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+static int bcache_writeback(struct bcache_buffer *buf) {
+    int res = disk_write_block(buf->disk, buf->lba, 1, buf->data);
+    if (res < 0) {
+        return res;
+    }
+
+    buf->dirty = false;
+    stats.dirty--;
+    stats.writebacks++;
+    return OK;
+}
+
+/**
+ * @brief Checks whether a sector comes before a position of the write-back sweep.
+ *
+ * Sectors are ordered by disk, then by LBA.
+ *
+ * @param buf The buffer of the sector.
+ * @param id The disk of the position.
+ * @param lba The sector of the position.
+ * @return true if the sector comes first.
+ */
+static bool bcache_before(struct bcache_buffer *buf, int id, unsigned int lba) {
+    return buf->disk->id < id || (buf->disk->id == id && buf->lba < lba);
+}
+
+/**
+ * @brief Writes back the dirty sectors of a disk, with the cache lock held.
+ *
+ * Sectors are written in ascending LBA order, one disk after the other, so each disk is crossed
+ * once.
+ *
+ * @param disk The disk to sync, or NULL for every disk.
+ * @return 0 on success, error code of the first failed write otherwise.
+ */
+static int bcache_sync_locked(struct disk *disk) {
+    int res = OK;
+    int from_id = 0;
+    unsigned int from_lba = 0;
+    for (;;) {
+        struct bcache_buffer *next = NULL;
+        for (int i = 0; i < TOYOS_BCACHE_BUFFERS; i++) {
+            struct bcache_buffer *buf = &buffers[i];
+            if (!buf->dirty || (disk && buf->disk != disk) || bcache_before(buf, from_id, from_lba)) {
+                continue;
+            }
+
+            if (!next || bcache_before(buf, next->disk->id, next->lba)) {
+                next = buf;
+            }
+        }
+
+        if (!next) {
+            break;
+        }
+
+        // A written sector is no longer dirty, a failed one stays dirty and the sweep moves past it
+        from_id = next->disk->id;
+        from_lba = next->lba;
+        int status = bcache_writeback(next);
+        if (status < 0) {
+            if (res == OK) {
+                res = status;
+            }
+
+            if (from_lba == 0xffffffff) {
+                from_id++;
+                from_lba = 0;
+            } else {
+                from_lba++;
+            }
+        }
+    }
+
+    last_sync_tick = vvar_get_ticks();
+    return res;
+}
+
+/**
+ * @brief Writes dirty sectors back if too many have accumulated or they have waited too long.
+ */
+static void bcache_maybe_sync(void) {
+    if (!stats.dirty) {
+        last_sync_tick = vvar_get_ticks();
+        return;
+    }
+
+    if (stats.dirty > TOYOS_BCACHE_DIRTY_MAX || vvar_get_ticks() - last_sync_tick >= TOYOS_BCACHE_SYNC_TICKS) {
+        bcache_sync_locked(NULL);
+    }
+}
+
+/**
+ * @brief Returns the buffer for a sector, claiming the least recently used buffer on a miss.
+ *
+ * @param disk The disk of the sector.
+ * @param lba The sector.
+ * @param load Whether a claimed buffer must be filled from the disk.
+ * @param out Receives the buffer.
+ * @return 0 on success, error code otherwise.
+ */
+static int bcache_get(struct disk *disk, unsigned int lba, bool load, struct bcache_buffer **out) {
+    struct bcache_buffer *buf = bcache_lookup(disk, lba);
+    if (buf) {
+        stats.hits++;
+        bcache_lru_touch(buf);
+        *out = buf;
+        return OK;
+    }
+
+    stats.misses++;
+    buf = lru_tail;
+    if (buf->dirty) {
+        int res = bcache_writeback(buf);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    if (buf->disk) {
+        bcache_unhash(buf);
+    }
+
+    if (load) {
+        int res = disk_read_block(disk, lba, 1, buf->data);
+        if (res < 0) {
+            bcache_lru_discard(buf);
+            return res;
+        }
+    }
+
+    buf->disk = disk;
+    buf->lba = lba;
+    struct bcache_buffer **bucket = bcache_bucket(disk, lba);
+    buf->hash_next = *bucket;
+    *bucket = buf;
+    bcache_lru_touch(buf);
+
+    *out = buf;
+    return OK;
+}
+
+int bcache_init(void) {
+    buffers = kzalloc(sizeof(struct bcache_buffer) * TOYOS_BCACHE_BUFFERS);
+    if (!buffers) {
+        return -ENOMEM;
+    }
+
+    for (int i = 0; i < TOYOS_BCACHE_BUFFERS; i++) {
+        bcache_lru_discard(&buffers[i]);
+    }
+
+    stats.buffers = TOYOS_BCACHE_BUFFERS;
+    return OK;
+}
+
+int bcache_read(struct disk *disk, unsigned int lba, void *out, int offset, int len) {
+    if (!buffers || !disk || !out || offset < 0 || len < 0 || offset + len > TOYOS_SECTOR_SIZE) {
+        return -EINVARG;
+    }
+
+    // A RAM disk is memory already, caching it would only add a copy
+    if (disk->type == DISK_TYPE_RAM) {
+        return ramdisk_transfer(disk, lba, offset, out, len, false);
+    }
+
+    mutex_lock(&bcache_lock);
+    struct bcache_buffer *buf = NULL;
+    int res = bcache_get(disk, lba, true, &buf);
+    if (res < 0) {
+        goto out;
+    }
+
+    memcpy(out, buf->data + offset, len);
+    bcache_maybe_sync();
+
+out:
+    mutex_unlock(&bcache_lock);
+    return res;
+}
+
+int bcache_write(struct disk *disk, unsigned int lba, const void *in, int offset, int len) {
+    if (!buffers || !disk || !in || offset < 0 || len < 0 || offset + len > TOYOS_SECTOR_SIZE) {
+        return -EINVARG;
+    }
+
+    if (disk->type == DISK_TYPE_RAM) {
+        disk->generation++;
+        return ramdisk_transfer(disk, lba, offset, (void *)in, len, true);
+    }
+
+    mutex_lock(&bcache_lock);
+    struct bcache_buffer *buf = NULL;
+    int res = bcache_get(disk, lba, len != TOYOS_SECTOR_SIZE, &buf);
+    if (res < 0) {
+        goto out;
+    }
+
+    memcpy(buf->data + offset, (void *)in, len);
+    disk->generation++;
+    if (!buf->dirty) {
+        buf->dirty = true;
+        stats.dirty++;
+    }
+
+    bcache_maybe_sync();
+
+out:
+    mutex_unlock(&bcache_lock);
+    return res;
+}
+
+int bcache_read_sectors(struct disk *disk, unsigned int lba, int count, void *out) {
+    if (!buffers || !disk || !out || count < 0) {
+        return -EINVARG;
+    }
+
+    if (disk->type == DISK_TYPE_RAM) {
+        return ramdisk_transfer(disk, lba, 0, out, count * TOYOS_SECTOR_SIZE, false);
+    }
+
+    // Held across the read, so no cached sector can be written back and dropped before the overlay
+    mutex_lock(&bcache_lock);
+    int res = disk_read_block(disk, lba, count, out);
+    if (res < 0) {
+        goto out;
+    }
+
+    for (int i = 0; i < TOYOS_BCACHE_BUFFERS; i++) {
+        struct bcache_buffer *buf = &buffers[i];
+        if (buf->disk == disk && buf->lba >= lba && buf->lba - lba < (unsigned int)count) {
+            memcpy((char *)out + (buf->lba - lba) * TOYOS_SECTOR_SIZE, buf->data, TOYOS_SECTOR_SIZE);
+        }
+    }
+
+out:
+    mutex_unlock(&bcache_lock);
+    return res;
+}
+
+int bcache_write_sectors(struct disk *disk, unsigned int lba, int count, const void *in) {
+    if (!buffers || !disk || !in || count < 0) {
+        return -EINVARG;
+    }
+
+    disk->generation++;
+    if (disk->type == DISK_TYPE_RAM) {
+        return ramdisk_transfer(disk, lba, 0, (void *)in, count * TOYOS_SECTOR_SIZE, true);
+    }
+
+    mutex_lock(&bcache_lock);
+    int res = disk_write_block(disk, lba, count, (void *)in);
+    if (res < 0) {
+        goto out;
+    }
+
+    for (int i = 0; i < TOYOS_BCACHE_BUFFERS; i++) {
+        struct bcache_buffer *buf = &buffers[i];
+        if (buf->disk != disk || buf->lba < lba || buf->lba - lba >= (unsigned int)count) {
+            continue;
+        }
+
+        memcpy(buf->data, (char *)in + (buf->lba - lba) * TOYOS_SECTOR_SIZE, TOYOS_SECTOR_SIZE);
+        if (buf->dirty) {
+            buf->dirty = false;
+            stats.dirty--;
+        }
+    }
+
+out:
+    mutex_unlock(&bcache_lock);
+    return res;
+}
+
+int bcache_sync(struct disk *disk) {
+    if (!buffers) {
+        return OK;
+    }
+
+    mutex_lock(&bcache_lock);
+    int res = bcache_sync_locked(disk);
+    mutex_unlock(&bcache_lock);
+    return res;
+}
+
+void bcache_get_stats(struct bcache_stats *out) {
+    mutex_lock(&bcache_lock);
+    *out = stats;
+    mutex_unlock(&bcache_lock);
+}
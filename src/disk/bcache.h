@@ -0,0 +1,103 @@
+#ifndef _DISK_BCACHE_H_
+#define _DISK_BCACHE_H_
+
+#include <stdint.h>
+
+// Forward declaration of disk
+struct disk;
+
+/**
+ * @brief Statistics of the buffer cache.
+ */
+struct bcache_stats {
+    uint32_t hits;       /**< Accesses served from a cached sector. */
+    uint32_t misses;     /**< Accesses that needed a buffer to be filled or claimed. */
+    uint32_t writebacks; /**< Dirty sectors written to the disk. */
+    uint32_t dirty;      /**< Sectors currently waiting to be written back. */
+    uint32_t buffers;    /**< Number of buffers in the cache. */
+};
+
+/**
+ * @brief Allocates the buffers of the cache.
+ *
+ * Must be called after the heap is initialized and before any disk is accessed through the cache.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+int bcache_init(void);
+
+/**
+ * @brief Reads part of a sector through the cache.
+ *
+ * The sector is read from the disk only if it is not cached. The least recently used buffer is
+ * reused for it, after writing it back if it is dirty.
+ *
+ * @param disk The disk to read from.
+ * @param lba The sector to read.
+ * @param out The buffer to copy the data to.
+ * @param offset Offset of the data within the sector.
+ * @param len Number of bytes to copy, with offset + len at most the sector size.
+ * @return 0 on success, error code otherwise.
+ */
+int bcache_read(struct disk *disk, unsigned int lba, void *out, int offset, int len);
+
+/**
+ * @brief Writes part of a sector through the cache.
+ *
+ * The cached sector is updated and marked dirty, and only reaches the disk when it is evicted or
+ * synced. A sector that is written as a whole is not read first.
+ *
+ * @param disk The disk to write to.
+ * @param lba The sector to write.
+ * @param in The data to write.
+ * @param offset Offset of the data within the sector.
+ * @param len Number of bytes to write, with offset + len at most the sector size.
+ * @return 0 on success, error code otherwise.
+ */
+int bcache_write(struct disk *disk, unsigned int lba, const void *in, int offset, int len);
+
+/**
+ * @brief Reads whole sectors around the cache.
+ *
+ * The sectors are read from the disk with a single request straight into the buffer, without
+ * displacing cached sectors. Cached copies of sectors in the range then replace what was read,
+ * as they may not have been written back yet.
+ *
+ * @param disk The disk to read from.
+ * @param lba The first sector to read.
+ * @param count Number of sectors.
+ * @param out The buffer, which receives count sectors.
+ * @return 0 on success, error code otherwise.
+ */
+int bcache_read_sectors(struct disk *disk, unsigned int lba, int count, void *out);
+
+/**
+ * @brief Writes whole sectors around the cache.
+ *
+ * The sectors are written to the disk with a single request straight from the buffer. Cached
+ * copies of sectors in the range are updated and, now matching the disk, are no longer dirty.
+ *
+ * @param disk The disk to write to.
+ * @param lba The first sector to write.
+ * @param count Number of sectors.
+ * @param in The buffer holding count sectors.
+ * @return 0 on success, error code otherwise.
+ */
+int bcache_write_sectors(struct disk *disk, unsigned int lba, int count, const void *in);
+
+/**
+ * @brief Writes the dirty sectors of a disk back, in ascending LBA order.
+ *
+ * @param disk The disk to sync, or NULL for every disk.
+ * @return 0 on success, error code of the first failed write otherwise.
+ */
+int bcache_sync(struct disk *disk);
+
+/**
+ * @brief Copies the statistics of the cache.
+ *
+ * @param stats Receives the statistics.
+ */
+void bcache_get_stats(struct bcache_stats *stats);
+
+#endif
@@ -1,117 +1,668 @@
 #include "disk.h"
 #include "config.h"
+#include "disk/queue.h"
+#include "disk/ramdisk.h"
 #include "io/io.h"
+#include "locks/mutex.h"
+#include "memory/heap/kheap.h"
 #include "memory/memory.h"
 #include "status.h"
+#include "stdlib/printf.h"
 
-struct disk disk;
+// Most requests submitted at once by a single read or write
+#define DISK_MAX_BATCH 16
+
+// Most sectors moved by one programmed I/O command, a sector count of 0 means 256
+#define DISK_PIO_MAX_SECTORS 256
+
+// ATA task file registers, offsets from the command block of a channel
+#define ATA_REG_DATA 0x00
+#define ATA_REG_SECTOR_COUNT 0x02
+#define ATA_REG_LBA_LOW 0x03
+#define ATA_REG_LBA_MID 0x04
+#define ATA_REG_LBA_HIGH 0x05
+#define ATA_REG_DRIVE 0x06
+#define ATA_REG_COMMAND 0x07
+#define ATA_REG_STATUS 0x07
+
+// ATA commands
+#define ATA_CMD_READ_SECTORS 0x20
+#define ATA_CMD_WRITE_SECTORS 0x30
+#define ATA_CMD_IDENTIFY 0xec
+
+// ATA status bits
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_BSY 0x80
+
+// Drive register values selecting a drive in LBA mode, the low nibble holds LBA bits 24-27
+#define ATA_DRIVE_MASTER_LBA 0xe0
+#define ATA_DRIVE_SLAVE_LBA 0xf0
+
+// Device control register bit that keeps the drive from raising its interrupt
+#define ATA_CONTROL_NIEN 0x02
+
+// IDENTIFY words 60 and 61 hold the number of sectors addressable with LBA28
+#define ATA_IDENTIFY_LBA28_SECTORS 60
+
+// Polls of the drive before it is considered absent
+#define ATA_TIMEOUT 1000000
+
+// Master boot record layout
+#define MBR_PARTITION_TABLE 0x1be
+#define MBR_PARTITIONS 4
+#define MBR_SIGNATURE_OFFSET 0x1fe
+#define MBR_SIGNATURE 0xaa55
+#define MBR_TYPE_EMPTY 0x00
+#define MBR_TYPE_EXTENDED 0x05
+#define MBR_TYPE_EXTENDED_LBA 0x0f
+
+/**
+ * @brief An ATA drive accessed with programmed I/O
+ *
+ * @var command Base port of the task file registers of its channel.
+ * @var control Port of the device control register of its channel.
+ * @var select Drive register value that selects the drive in LBA mode.
+ * @var lock Serializes programmed I/O on the channel, whose registers both drives share.
+ */
+struct ata_drive {
+    uint16_t command;
+    uint16_t control;
+    uint8_t select;
+    struct mutex *lock;
+};
+
+/**
+ * @brief Partition table entry of a master boot record
+ */
+struct mbr_partition {
+    uint8_t status;
+    uint8_t chs_first[3];
+    uint8_t type;
+    uint8_t chs_last[3];
+    uint32_t lba_first;
+    uint32_t sectors;
+} __attribute__((packed));
+
+// Held across programmed I/O commands, one per channel. A mutex, since a command may wait long
+static struct mutex ata_channel_locks[2] = {MUTEX_INIT, MUTEX_INIT};
+
+// The drives of the primary and secondary channels, master first
+static struct ata_drive ata_drives[DISK_ATA_DRIVES] = {
+    {0x1f0, 0x3f6, ATA_DRIVE_MASTER_LBA, &ata_channel_locks[0]},
+    {0x1f0, 0x3f6, ATA_DRIVE_SLAVE_LBA, &ata_channel_locks[0]},
+    {0x170, 0x376, ATA_DRIVE_MASTER_LBA, &ata_channel_locks[1]},
+    {0x170, 0x376, ATA_DRIVE_SLAVE_LBA, &ata_channel_locks[1]},
+};
+
+// Whole devices of the ATA drives that were found
+static struct disk ata_disks[DISK_ATA_DRIVES];
+static bool ata_present[DISK_ATA_DRIVES];
+
+// Registered disks, indexed by their ID
+static struct disk *disks[TOYOS_MAX_DISKS];
+static int disk_count = 0;
+
+/**
+ * @brief Returns the ATA drive behind a whole device.
+ *
+ * @param device The device.
+ * @return The drive, or NULL if the device is not an ATA drive.
+ */
+static struct ata_drive *disk_ata_drive(struct disk *device) {
+    return device->type == DISK_TYPE_REAL ? device->driver_data : NULL;
+}
+
+/**
+ * @brief Waits for a drive to request data.
+ *
+ * @param drive The drive.
+ * @return 0 once it is ready, -EIO if the drive reported an error.
+ */
+static int disk_wait_drq(struct ata_drive *drive) {
+    for (;;) {
+        uint8_t status = insb(drive->command + ATA_REG_STATUS);
+        if (status & ATA_STATUS_BSY) {
+            continue;
+        }
+
+        if (status & ATA_STATUS_ERR) {
+            return -EIO;
+        }
+
+        if (status & ATA_STATUS_DRQ) {
+            return OK;
+        }
+    }
+}
+
+/**
+ * @brief Selects the sectors of the next programmed I/O command and issues it.
+ *
+ * @param drive The drive.
+ * @param lba LBA address of the first sector.
+ * @param total Number of sectors, at most DISK_PIO_MAX_SECTORS.
+ * @param command The ATA command.
+ */
+static void disk_pio_command(struct ata_drive *drive, unsigned int lba, int total, uint8_t command) {
+    outb(drive->command + ATA_REG_DRIVE, drive->select | ((lba >> 24) & 0x0f));
+    outb(drive->command + ATA_REG_SECTOR_COUNT, (uint8_t)total);
+    outb(drive->command + ATA_REG_LBA_LOW, (unsigned char)(lba & 0xff));
+    outb(drive->command + ATA_REG_LBA_MID, (unsigned char)(lba >> 8));
+    outb(drive->command + ATA_REG_LBA_HIGH, (unsigned char)(lba >> 16));
+    outb(drive->command + ATA_REG_COMMAND, command);
+}
+
+/**
+ * @brief Takes the channel of a drive for programmed I/O.
+ *
+ * Other programmed I/O on the channel waits for the lock. Request queues of drives on the channel
+ * are paused, so no DMA command is in flight or started while the task file is in use.
+ *
+ * @param drive The drive.
+ */
+static void disk_ata_claim(struct ata_drive *drive) {
+    mutex_lock(drive->lock);
+    for (int i = 0; i < DISK_ATA_DRIVES; i++) {
+        if (ata_present[i] && ata_drives[i].lock == drive->lock && ata_disks[i].queue) {
+            disk_queue_pause(ata_disks[i].queue);
+        }
+    }
+}
+
+/**
+ * @brief Releases the channel taken by disk_ata_claim().
+ *
+ * @param drive The drive.
+ */
+static void disk_ata_release(struct ata_drive *drive) {
+    for (int i = 0; i < DISK_ATA_DRIVES; i++) {
+        if (ata_present[i] && ata_drives[i].lock == drive->lock && ata_disks[i].queue) {
+            disk_queue_resume(ata_disks[i].queue);
+        }
+    }
+
+    mutex_unlock(drive->lock);
+}
 
 /**
  * @brief Writes data to a specific sector on the disk.
  *
+ * @param drive The drive to write to.
  * @param lba Logical Block Addressing (LBA) address of the sector to write to.
  * @param total Number of sectors to write.
  * @param buf Buffer containing the data to be written.
  * @return 0 on success, or an error code if failed.
  */
-static int disk_write_sector(int lba, int total, void *buf) {
+static int disk_write_sector(struct ata_drive *drive, unsigned int lba, int total, void *buf) {
     if (!buf) {
         return -EINVARG;
     }
 
-    outb(0x1f6, (lba >> 24) | 0xe0);
-    outb(0x1f2, total);
-    outb(0x1f3, (unsigned char)(lba & 0xff));
-    outb(0x1f4, (unsigned char)(lba >> 8));
-    outb(0x1f5, (unsigned char)(lba >> 16));
-    outb(0x1f7, 0x30);  // 0x30 is the command for write
-
+    int res = OK;
     unsigned short *ptr = (unsigned short *)buf;
 
-    for (int i = 0; i < total; i++) {
-        // Wait for the buffer to be ready
-        char c = insb(0x1f7);
-        while (!(c & 0x08)) {
-            c = insb(0x1f7);
-        }
+    disk_ata_claim(drive);
+    while (total > 0) {
+        int count = total < DISK_PIO_MAX_SECTORS ? total : DISK_PIO_MAX_SECTORS;
+        disk_pio_command(drive, lba, count, ATA_CMD_WRITE_SECTORS);
+
+        for (int i = 0; i < count; i++) {
+            // Wait for the buffer to be ready
+            if (disk_wait_drq(drive) < 0) {
+                res = -EIO;
+                goto out;
+            }
 
-        // Copy from memory to hard disk
-        for (int j = 0; j < 256; j++) {
-            outw(0x1f0, *ptr);
-            ptr++;
+            // Copy from memory to hard disk
+            for (int j = 0; j < 256; j++) {
+                outw(drive->command + ATA_REG_DATA, *ptr);
+                ptr++;
+            }
         }
+
+        lba += count;
+        total -= count;
     }
 
-    return OK;
+out:
+    disk_ata_release(drive);
+    return res;
 }
 
 /**
  * @brief Reads data from a specific sector on the disk.
  *
+ * @param drive The drive to read from.
  * @param lba Logical Block Addressing (LBA) address of the sector to read from.
  * @param total Number of sectors to read.
  * @param buf Buffer to store the read data.
  * @return 0 on success, or an error code if failed.
  */
-static int disk_read_sector(int lba, int total, void *buf) {
+static int disk_read_sector(struct ata_drive *drive, unsigned int lba, int total, void *buf) {
     if (!buf) {
         return -EINVARG;
     }
 
-    outb(0x1f6, (lba >> 24) | 0xe0);
-    outb(0x1f2, total);
-    outb(0x1f3, (unsigned char)(lba & 0xff));
-    outb(0x1f4, (unsigned char)(lba >> 8));
-    outb(0x1f5, (unsigned char)(lba >> 16));
-    outb(0x1f7, 0x20);
-
+    int res = OK;
     unsigned short *ptr = (unsigned short *)buf;
 
-    for (int i = 0; i < total; i++) {
-        // Wait for the buffer to be ready
-        char c = insb(0x1f7);
-        while (!(c & 0x08)) {
-            c = insb(0x1f7);
+    disk_ata_claim(drive);
+    while (total > 0) {
+        int count = total < DISK_PIO_MAX_SECTORS ? total : DISK_PIO_MAX_SECTORS;
+        disk_pio_command(drive, lba, count, ATA_CMD_READ_SECTORS);
+
+        for (int i = 0; i < count; i++) {
+            // Wait for the buffer to be ready
+            if (disk_wait_drq(drive) < 0) {
+                res = -EIO;
+                goto out;
+            }
+
+            // Copy from hard disk to memory
+            for (int j = 0; j < 256; j++) {
+                *ptr = insw(drive->command + ATA_REG_DATA);
+                ptr++;
+            }
         }
 
-        // Copy from hard disk to memory
-        for (int j = 0; j < 256; j++) {
-            *ptr = insw(0x1f0);
-            ptr++;
+        lba += count;
+        total -= count;
+    }
+
+out:
+    disk_ata_release(drive);
+    return res;
+}
+
+/**
+ * @brief Checks with IDENTIFY whether an ATA hard disk is attached.
+ *
+ * ATAPI devices abort the command and are not used.
+ *
+ * @param drive The drive to check.
+ * @param sectors Receives the number of sectors of the drive.
+ * @return true if the drive is present, false otherwise.
+ */
+static bool disk_ata_identify(struct ata_drive *drive, unsigned int *sectors) {
+    // A floating bus reads as all ones when the channel has no drives
+    if (insb(drive->command + ATA_REG_STATUS) == 0xff) {
+        return false;
+    }
+
+    outb(drive->command + ATA_REG_DRIVE, drive->select);
+    outb(drive->command + ATA_REG_SECTOR_COUNT, 0);
+    outb(drive->command + ATA_REG_LBA_LOW, 0);
+    outb(drive->command + ATA_REG_LBA_MID, 0);
+    outb(drive->command + ATA_REG_LBA_HIGH, 0);
+    outb(drive->command + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+
+    // A status of 0 means there is no drive
+    uint8_t status = insb(drive->command + ATA_REG_STATUS);
+    if (status == 0) {
+        return false;
+    }
+
+    int i = 0;
+    while ((status & ATA_STATUS_BSY) && i++ < ATA_TIMEOUT) {
+        status = insb(drive->command + ATA_REG_STATUS);
+    }
+
+    // ATAPI and SATA devices set the signature in the LBA registers instead of completing
+    if ((status & ATA_STATUS_BSY) || insb(drive->command + ATA_REG_LBA_MID) ||
+        insb(drive->command + ATA_REG_LBA_HIGH)) {
+        return false;
+    }
+
+    while (!(status & (ATA_STATUS_DRQ | ATA_STATUS_ERR)) && i++ < ATA_TIMEOUT) {
+        status = insb(drive->command + ATA_REG_STATUS);
+    }
+
+    if (!(status & ATA_STATUS_DRQ) || (status & ATA_STATUS_ERR)) {
+        return false;
+    }
+
+    uint32_t count = 0;
+    for (int word = 0; word < 256; word++) {
+        uint16_t value = insw(drive->command + ATA_REG_DATA);
+        if (word == ATA_IDENTIFY_LBA28_SECTORS) {
+            count |= value;
+        } else if (word == ATA_IDENTIFY_LBA28_SECTORS + 1) {
+            count |= (uint32_t)value << 16;
         }
     }
 
-    return OK;
+    *sectors = count;
+    return true;
+}
+
+/**
+ * @brief Adds a disk to the table without looking for a file system.
+ *
+ * @param idisk The disk.
+ * @return The index of the disk, or an error code.
+ */
+static int disk_insert(struct disk *idisk) {
+    if (disk_count >= TOYOS_MAX_DISKS) {
+        return -ENOMEM;
+    }
+
+    idisk->id = disk_count;
+    disks[disk_count++] = idisk;
+    return idisk->id;
+}
+
+/**
+ * @brief Adds a disk to the table and resolves its file system.
+ *
+ * @param idisk The disk.
+ * @return The index of the disk, or an error code.
+ */
+static int disk_add(struct disk *idisk) {
+    int index = disk_insert(idisk);
+    if (index < 0) {
+        return index;
+    }
+
+    idisk->fs = fs_resolve(idisk);
+    return index;
+}
+
+/**
+ * @brief Registers the primary partitions of a device as disks.
+ *
+ * Extended partitions are skipped, as are entries that do not fit on the device.
+ *
+ * @param device The device, which is not registered itself.
+ * @return The index of the first partition, or an error code if there is no partition table.
+ */
+static int disk_add_partitions(struct disk *device) {
+    char *sector = kzalloc(TOYOS_SECTOR_SIZE);
+    if (!sector) {
+        return -ENOMEM;
+    }
+
+    int res = disk_read_block(device, 0, 1, sector);
+    if (res < 0) {
+        goto out;
+    }
+
+    res = -EFSNOTUS;
+    if (*(uint16_t *)(sector + MBR_SIGNATURE_OFFSET) != MBR_SIGNATURE) {
+        goto out;
+    }
+
+    struct mbr_partition *table = (struct mbr_partition *)(sector + MBR_PARTITION_TABLE);
+    int first = -EFSNOTUS;
+    for (int i = 0; i < MBR_PARTITIONS; i++) {
+        struct mbr_partition *entry = &table[i];
+        if (entry->type == MBR_TYPE_EMPTY || entry->type == MBR_TYPE_EXTENDED ||
+            entry->type == MBR_TYPE_EXTENDED_LBA || !entry->lba_first || !entry->sectors) {
+            continue;
+        }
+
+        if (device->sectors &&
+            (entry->lba_first >= device->sectors || entry->sectors > device->sectors - entry->lba_first)) {
+            continue;
+        }
+
+        struct disk *partition = kzalloc(sizeof(struct disk));
+        if (!partition) {
+            res = -ENOMEM;
+            break;
+        }
+
+        partition->type = device->type;
+        partition->sector_size = device->sector_size;
+        partition->parent = device;
+        partition->lba_offset = entry->lba_first;
+        partition->sectors = entry->sectors;
+
+        int index = disk_add(partition);
+        if (index < 0) {
+            kfree(partition);
+            res = index;
+            break;
+        }
+
+        printf("Disk %i: partition %i at LBA %i, %i sectors\n", index, i + 1, entry->lba_first, entry->sectors);
+        if (first < 0) {
+            first = index;
+        }
+    }
+
+    if (first >= 0) {
+        res = first;
+    }
+
+out:
+    kfree(sector);
+    return res;
 }
 
 void disk_search_and_init(void) {
-    memset(&disk, 0, sizeof(disk));
-    disk.id = 0;
-    disk.type = DISK_TYPE_REAL;
-    disk.sector_size = TOYOS_SECTOR_SIZE;
-    disk.fs = fs_resolve(&disk);
+    for (int i = 0; i < DISK_ATA_DRIVES; i++) {
+        struct ata_drive *drive = &ata_drives[i];
+        unsigned int sectors = 0;
+
+        // The boot disk is used even if it does not answer IDENTIFY, as it always has been
+        if (!disk_ata_identify(drive, &sectors) && i != 0) {
+            continue;
+        }
+
+        // Nothing handles the interrupt of the secondary channel, its drives are polled
+        if (drive->command != ata_drives[0].command) {
+            outb(drive->control, ATA_CONTROL_NIEN);
+        }
+
+        struct disk *device = &ata_disks[i];
+        memset(device, 0, sizeof(struct disk));
+        device->type = DISK_TYPE_REAL;
+        device->sector_size = TOYOS_SECTOR_SIZE;
+        device->sectors = sectors;
+        device->driver_data = drive;
+        ata_present[i] = true;
+        disk_register(device);
+    }
+}
+
+int disk_register(struct disk *device) {
+    if (!device) {
+        return -EINVARG;
+    }
+
+    // A file system on the whole device, such as the boot disk, takes precedence over a partition table
+    int index = disk_add(device);
+    if (index < 0 || device->fs) {
+        return index;
+    }
+
+    disk_count--;
+    disks[index] = NULL;
+
+    int res = disk_add_partitions(device);
+    if (res >= 0) {
+        return res;
+    }
+
+    // Without partitions, the device stays reachable for raw access. It was already found to have no
+    // file system, so it is not resolved again.
+    return disk_insert(device);
 }
 
 struct disk *disk_get(int index) {
-    if (index != 0) {
+    if (index < 0 || index >= disk_count) {
         return NULL;
     }
 
-    return &disk;
+    return disks[index];
+}
+
+struct disk *disk_get_ata(int drive) {
+    if (drive < 0 || drive >= DISK_ATA_DRIVES || !ata_present[drive]) {
+        return NULL;
+    }
+
+    return &ata_disks[drive];
+}
+
+int disk_get_count(void) {
+    return disk_count;
+}
+
+/**
+ * @brief Transfers sectors through the request queue of the disk.
+ *
+ * The transfer is split into requests of at most the size of a driver command. These are submitted
+ * in batches so the driver goes from one to the next without waiting for the caller. A request
+ * that fails is retried with programmed I/O if the device is an ATA drive.
+ *
+ * @param device The whole device.
+ * @param queue The request queue of the device.
+ * @param lba LBA address of the first sector.
+ * @param total Number of sectors.
+ * @param buf The buffer to transfer to or from.
+ * @param write true to write to the disk, false to read from it.
+ * @return 0 on success, or an error code if failed.
+ */
+static int disk_queue_transfer(struct disk *device, struct disk_queue *queue, unsigned int lba, int total, void *buf,
+                               bool write) {
+    struct ata_drive *drive = disk_ata_drive(device);
+    struct disk_request requests[DISK_MAX_BATCH];
+    char *ptr = buf;
+    int res = OK;
+
+    while (total > 0) {
+        int count = 0;
+        while (count < DISK_MAX_BATCH && total > 0) {
+            int sectors = total < queue->max_sectors ? total : queue->max_sectors;
+            struct disk_request *req = &requests[count++];
+            disk_request_init(req, lba, sectors, ptr, write);
+            if (disk_queue_submit(queue, req) < 0) {
+                req->status = -EIO;
+                req->done = true;
+            }
+
+            lba += sectors;
+            total -= sectors;
+            ptr += sectors * TOYOS_SECTOR_SIZE;
+        }
+
+        // Every request must be waited for, they live on this stack
+        for (int i = 0; i < count; i++) {
+            struct disk_request *req = &requests[i];
+            int status = disk_request_wait(queue, req);
+            if (status == OK) {
+                continue;
+            }
+
+            if (!drive) {
+                res = status;
+                continue;
+            }
+
+            int pio = write ? disk_write_sector(drive, req->lba, req->total, req->buf)
+                            : disk_read_sector(drive, req->lba, req->total, req->buf);
+            if (pio < 0) {
+                res = pio;
+            }
+        }
+    }
+
+    return res;
+}
+
+/**
+ * @brief Checks whether a transfer can go through the request queue of a device.
+ *
+ * @param device The whole device.
+ * @param buf The buffer to transfer to or from.
+ * @return true if the device has a queue that can take the buffer.
+ */
+static bool disk_can_queue(struct disk *device, void *buf) {
+    if (!device->queue || !buf) {
+        return false;
+    }
+
+    // The IDE DMA engine needs word aligned buffers, programmed I/O remains the fallback
+    return !disk_ata_drive(device) || !((uint32_t)buf & 1);
+}
+
+/**
+ * @brief Maps sectors of a disk to sectors of its whole device.
+ *
+ * @param idisk The disk, possibly a partition.
+ * @param lba LBA address within the disk, updated to the address on the device.
+ * @param total Number of sectors.
+ * @return The whole device, or NULL if the sectors lie outside the disk.
+ */
+static struct disk *disk_map(struct disk *idisk, unsigned int *lba, int total) {
+    if (!idisk || total < 0) {
+        return NULL;
+    }
+
+    if (idisk->sectors && (*lba >= idisk->sectors || (unsigned int)total > idisk->sectors - *lba)) {
+        return NULL;
+    }
+
+    if (idisk->parent) {
+        *lba += idisk->lba_offset;
+        return idisk->parent;
+    }
+
+    return idisk;
 }
 
 int disk_read_block(struct disk *idisk, unsigned int lba, int total, void *buf) {
-    if (idisk != &disk) {
+    struct disk *device = disk_map(idisk, &lba, total);
+    if (!device) {
+        return -EIO;
+    }
+
+    if (device->type == DISK_TYPE_RAM) {
+        return ramdisk_transfer(device, lba, 0, buf, total * TOYOS_SECTOR_SIZE, false);
+    }
+
+    if (disk_can_queue(device, buf)) {
+        return disk_queue_transfer(device, device->queue, lba, total, buf, false);
+    }
+
+    struct ata_drive *drive = disk_ata_drive(device);
+    if (!drive) {
         return -EIO;
     }
 
-    return disk_read_sector(lba, total, buf);
+    return disk_read_sector(drive, lba, total, buf);
+}
+
+int disk_read_block_pio(struct disk *idisk, unsigned int lba, int total, void *buf) {
+    struct disk *device = disk_map(idisk, &lba, total);
+    struct ata_drive *drive = device ? disk_ata_drive(device) : NULL;
+    if (!drive) {
+        return -EIO;
+    }
+
+    return disk_read_sector(drive, lba, total, buf);
 }
 
 int disk_write_block(struct disk *idisk, unsigned int lba, int total, void *buf) {
-    if (idisk != &disk) {
+    struct disk *device = disk_map(idisk, &lba, total);
+    if (!device) {
+        return -EIO;
+    }
+
+    if (device->type == DISK_TYPE_RAM) {
+        return ramdisk_transfer(device, lba, 0, buf, total * TOYOS_SECTOR_SIZE, true);
+    }
+
+    if (disk_can_queue(device, buf)) {
+        return disk_queue_transfer(device, device->queue, lba, total, buf, true);
+    }
+
+    struct ata_drive *drive = disk_ata_drive(device);
+    if (!drive) {
         return -EIO;
     }
 
-    return disk_write_sector(lba, total, buf);
+    return disk_write_sector(drive, lba, total, buf);
 }
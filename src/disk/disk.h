@@ -4,20 +4,52 @@
 #include "fs/file.h"
 
 /**
- * @brief Represents the type of a physical hard disk.
+ * @brief Represents the type of a physical (ATA) hard disk.
  */
 #define DISK_TYPE_REAL 0
 
+/**
+ * @brief Represents the type of a virtio block device.
+ */
+#define DISK_TYPE_VIRTIO 1
+
+/**
+ * @brief Represents the type of a disk held in memory.
+ */
+#define DISK_TYPE_RAM 2
+
 typedef unsigned int disk_type;
 
+/**
+ * @brief Number of ATA drives probed: master and slave of the primary and secondary channels.
+ */
+#define DISK_ATA_DRIVES 4
+
+// Forward declaration of disk_queue
+struct disk_queue;
+
 /**
  * @brief Structure representing a disk.
+ *
+ * A disk is either a whole device or a partition of one. Sectors of a partition are relative to
+ * its start, and are moved by the device it belongs to.
  */
 struct disk {
     disk_type type;  /**< Type of the disk. */
     int sector_size; /**< Size of a sector in bytes. */
     int id;          /**< Identifier for the disk. */
 
+    struct disk *parent;     /**< The whole device of a partition, or NULL for a device. */
+    unsigned int lba_offset; /**< First sector of a partition on its device. */
+    unsigned int sectors;    /**< Number of sectors, or 0 if unknown. */
+    void *driver_data;       /**< Driver data of a device, such as its ATA drive. */
+    unsigned int generation; /**< Incremented by every cached write, so copies can tell they are stale. */
+
+    /**
+     * @brief Request queue of the driver, or NULL if the disk is accessed with programmed I/O.
+     */
+    struct disk_queue *queue;
+
     /**
      * @brief Filesystem associated with the disk.
      */
@@ -40,6 +72,19 @@ struct disk {
  */
 int disk_read_block(struct disk *idisk, unsigned int lba, int total, void *buf);
 
+/**
+ * @brief Reads a block of data from the disk with programmed I/O, even if DMA is available.
+ *
+ * Used to compare the two transfer modes. Only the ATA disk supports programmed I/O.
+ *
+ * @param idisk Pointer to the disk structure.
+ * @param lba Logical Block Addressing (LBA) address to read from.
+ * @param total Number of sectors to read.
+ * @param buf Buffer to store the read data.
+ * @return 0 on success, error code otherwise.
+ */
+int disk_read_block_pio(struct disk *idisk, unsigned int lba, int total, void *buf);
+
 /**
  * @brief Writes a block of data to the disk.
  *
@@ -53,9 +98,39 @@ int disk_write_block(struct disk *idisk, unsigned int lba, int total, void *buf)
 
 /**
  * @brief Searches for available disks and initializes them.
+ *
+ * Probes the master and slave drives of both ATA channels and registers each one that is
+ * present, so the boot disk comes first. Disks found later by their drivers follow them.
  */
 void disk_search_and_init(void);
 
+/**
+ * @brief Adds a device and resolves its file systems.
+ *
+ * If a file system is found on the whole device, or it has no partition table, the device is
+ * one disk. Otherwise each primary partition of its master boot record becomes a disk of its own.
+ * Devices other than ATA drives need a request queue, as they have no programmed I/O fallback.
+ *
+ * @param device The device, which must stay valid.
+ * @return The index of the first disk, or an error code.
+ */
+int disk_register(struct disk *device);
+
+/**
+ * @brief Retrieves the whole device of an ATA drive.
+ *
+ * @param drive 0 and 1 for the master and slave of the primary channel, 2 and 3 for the secondary.
+ * @return The device, or NULL if the drive is not present.
+ */
+struct disk *disk_get_ata(int drive);
+
+/**
+ * @brief Returns the number of registered disks.
+ *
+ * @return The number of disks.
+ */
+int disk_get_count(void);
+
 /**
  * @brief Retrieves a disk by its index.
  *
@@ -0,0 +1,287 @@
+#include "queue.h"
+#include "status.h"
+#include "task/task.h"
+
+/**
+ * @brief Returns the sector following the last request of a chain.
+ *
+ * @param chain The first request of the chain.
+ * @return The end of the chain.
+ */
+static unsigned int disk_chain_end(struct disk_request *chain) {
+    while (chain->merged) {
+        chain = chain->merged;
+    }
+
+    return chain->lba + chain->total;
+}
+
+/**
+ * @brief Checks whether a request may be merged into a chain.
+ *
+ * @param queue The queue holding the chain.
+ * @param chain The first request of the chain.
+ * @param req The request to merge.
+ * @return true if the merged chain stays within the limits of the driver.
+ */
+static bool disk_chain_can_merge(struct disk_queue *queue, struct disk_request *chain, struct disk_request *req) {
+    if (chain->write != req->write) {
+        return false;
+    }
+
+    int sectors = req->total;
+    int requests = 1;
+    for (struct disk_request *r = chain; r; r = r->merged) {
+        sectors += r->total;
+        requests++;
+    }
+
+    return sectors <= queue->max_sectors && requests <= queue->max_requests;
+}
+
+/**
+ * @brief Marks every request of a chain as done.
+ *
+ * @param chain The first request of the chain.
+ * @param status The status given to each request.
+ */
+static void disk_chain_finish(struct disk_request *chain, int status) {
+    while (chain) {
+        // The waiter may reuse the request as soon as it is done
+        struct disk_request *next = chain->merged;
+        chain->status = status;
+        __sync_synchronize();
+        chain->done = true;
+        chain = next;
+    }
+}
+
+/**
+ * @brief Checks whether a request touches sectors of a queued or active request.
+ *
+ * @param queue The queue to check, with its lock held.
+ * @param req The request to check.
+ * @return true if the request overlaps a queued or active request.
+ */
+static bool disk_queue_overlaps(struct disk_queue *queue, struct disk_request *req) {
+    unsigned int end = req->lba + req->total;
+    for (struct disk_request *chain = queue->active; chain; chain = chain->next) {
+        if (req->lba < disk_chain_end(chain) && chain->lba < end) {
+            return true;
+        }
+    }
+
+    for (struct disk_request *chain = queue->pending; chain; chain = chain->next) {
+        if (req->lba < disk_chain_end(chain) && chain->lba < end) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Removes a chain from the active list.
+ *
+ * @param queue The queue, with its lock held.
+ * @param chain The chain to remove.
+ * @return true if the chain was active, false otherwise.
+ */
+static bool disk_queue_remove_active(struct disk_queue *queue, struct disk_request *chain) {
+    for (struct disk_request **link = &queue->active; *link; link = &(*link)->next) {
+        if (*link == chain) {
+            *link = chain->next;
+            chain->next = NULL;
+            queue->active_count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Adds a request to the pending chains, merging it with an adjacent chain if possible.
+ *
+ * @param queue The queue, with its lock held.
+ * @param req The request to add.
+ */
+static void disk_queue_insert(struct disk_queue *queue, struct disk_request *req) {
+    struct disk_request **link = &queue->pending;
+    struct disk_request *prev = NULL;
+    while (*link && (*link)->lba < req->lba) {
+        prev = *link;
+        link = &(*link)->next;
+    }
+
+    struct disk_request *next = *link;
+
+    // Back merge, the request continues the previous chain
+    if (prev && disk_chain_end(prev) == req->lba && disk_chain_can_merge(queue, prev, req)) {
+        struct disk_request *tail = prev;
+        while (tail->merged) {
+            tail = tail->merged;
+        }
+
+        tail->merged = req;
+        return;
+    }
+
+    // Front merge, the request becomes the start of the next chain
+    if (next && req->lba + req->total == next->lba && disk_chain_can_merge(queue, next, req)) {
+        req->merged = next;
+        req->next = next->next;
+        next->next = NULL;
+        *link = req;
+        return;
+    }
+
+    req->next = next;
+    *link = req;
+}
+
+/**
+ * @brief Starts pending chains while the driver has room for more.
+ *
+ * Chains are served in ascending LBA order from the end of the previous one. Once no chain lies
+ * ahead, the sweep starts over from the lowest LBA.
+ *
+ * @param queue The queue, with its lock held.
+ */
+static void disk_queue_dispatch(struct disk_queue *queue) {
+    while (!queue->paused && queue->active_count < queue->max_active && queue->pending) {
+        struct disk_request **link = &queue->pending;
+        while (*link && (*link)->lba < queue->position) {
+            link = &(*link)->next;
+        }
+
+        if (!*link) {
+            link = &queue->pending;
+        }
+
+        struct disk_request *chain = *link;
+        *link = chain->next;
+
+        // Appended, so the active list stays in dispatch order
+        struct disk_request **tail = &queue->active;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+
+        chain->next = NULL;
+        *tail = chain;
+        queue->active_count++;
+        queue->position = disk_chain_end(chain);
+
+        int res = queue->ops->start(queue, chain);
+        if (res < 0) {
+            disk_queue_remove_active(queue, chain);
+            disk_chain_finish(chain, res);
+        }
+    }
+}
+
+/**
+ * @brief Lets time pass while a transfer is in progress.
+ *
+ * Other tasks run if there is a current task and preemption is enabled. The driver is polled in
+ * either case, since the completion interrupt may not have been taken yet.
+ *
+ * @param queue The queue being waited on.
+ */
+static void disk_queue_wait_step(struct disk_queue *queue) {
+    if (task_current() && preemptible()) {
+        task_yield();
+    }
+
+    queue->ops->poll(queue);
+}
+
+void disk_queue_init(struct disk_queue *queue, const struct disk_queue_ops *ops, void *driver_data, int max_sectors,
+                     int max_requests, int max_active) {
+    queue->ops = ops;
+    queue->driver_data = driver_data;
+    queue->max_sectors = max_sectors;
+    queue->max_requests = max_requests;
+    queue->max_active = max_active > 0 ? max_active : 1;
+    queue->pending = NULL;
+    queue->active = NULL;
+    queue->active_count = 0;
+    queue->position = 0;
+    queue->paused = 0;
+    spin_lock_init(&queue->lock, "disk_queue");
+}
+
+void disk_request_init(struct disk_request *req, unsigned int lba, int total, void *buf, bool write) {
+    req->lba = lba;
+    req->total = total;
+    req->buf = buf;
+    req->write = write;
+    req->done = false;
+    req->status = OK;
+    req->next = NULL;
+    req->merged = NULL;
+}
+
+int disk_queue_submit(struct disk_queue *queue, struct disk_request *req) {
+    if (!queue || !req || !req->buf || req->total <= 0 || req->total > queue->max_sectors) {
+        return -EINVARG;
+    }
+
+    req->done = false;
+    req->next = NULL;
+    req->merged = NULL;
+
+    for (;;) {
+        uint32_t flags = spin_lock_irqsave(&queue->lock);
+        if (!disk_queue_overlaps(queue, req)) {
+            disk_queue_insert(queue, req);
+            disk_queue_dispatch(queue);
+            spin_unlock_irqrestore(&queue->lock, flags);
+            return OK;
+        }
+
+        spin_unlock_irqrestore(&queue->lock, flags);
+        disk_queue_wait_step(queue);
+    }
+}
+
+int disk_request_wait(struct disk_queue *queue, struct disk_request *req) {
+    while (!req->done) {
+        disk_queue_wait_step(queue);
+    }
+
+    return req->status;
+}
+
+void disk_queue_pause(struct disk_queue *queue) {
+    uint32_t flags = spin_lock_irqsave(&queue->lock);
+    queue->paused++;
+    for (;;) {
+        bool idle = queue->active_count == 0;
+        spin_unlock_irqrestore(&queue->lock, flags);
+        if (idle) {
+            return;
+        }
+
+        disk_queue_wait_step(queue);
+        flags = spin_lock_irqsave(&queue->lock);
+    }
+}
+
+void disk_queue_resume(struct disk_queue *queue) {
+    uint32_t flags = spin_lock_irqsave(&queue->lock);
+    queue->paused--;
+    disk_queue_dispatch(queue);
+    spin_unlock_irqrestore(&queue->lock, flags);
+}
+
+void disk_queue_complete(struct disk_queue *queue, struct disk_request *chain, int status) {
+    uint32_t flags = spin_lock_irqsave(&queue->lock);
+    if (chain && disk_queue_remove_active(queue, chain)) {
+        disk_chain_finish(chain, status);
+    }
+
+    disk_queue_dispatch(queue);
+    spin_unlock_irqrestore(&queue->lock, flags);
+}
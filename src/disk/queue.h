@@ -0,0 +1,152 @@
+#ifndef _DISK_QUEUE_H_
+#define _DISK_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "locks/spinlock.h"
+
+struct disk_queue;
+
+/**
+ * @brief A transfer between a buffer and a run of consecutive sectors.
+ *
+ * Requests are submitted to a disk_queue and complete asynchronously. Requests for adjacent
+ * sectors are merged into a chain that the driver transfers with a single command.
+ */
+struct disk_request {
+    unsigned int lba; /**< First sector of the transfer. */
+    int total;        /**< Number of sectors. */
+    void *buf;        /**< Buffer holding total sectors, which must be word aligned. */
+    bool write;       /**< true to write the buffer to the disk, false to read into it. */
+
+    volatile bool done;  /**< Set when the request has completed. */
+    volatile int status; /**< 0 on success or an error code, valid once done is set. */
+
+    struct disk_request *next;   /**< Next chain in the pending or active list. */
+    struct disk_request *merged; /**< Next request of the same chain, for the following sectors. */
+};
+
+/**
+ * @brief Operations a driver provides to a disk_queue.
+ */
+struct disk_queue_ops {
+    /**
+     * @brief Starts transferring a chain of merged requests.
+     *
+     * Called with the queue lock held and interrupts disabled. The driver calls
+     * disk_queue_complete() with the chain once its transfer has finished.
+     *
+     * @return 0 if the transfer was started, error code otherwise.
+     */
+    int (*start)(struct disk_queue *queue, struct disk_request *chain);
+
+    /**
+     * @brief Checks the hardware for a completed transfer.
+     *
+     * Used by waiters that cannot switch to another task while the transfer is in progress: there
+     * is no current task yet, or preemption is disabled.
+     */
+    void (*poll)(struct disk_queue *queue);
+};
+
+/**
+ * @brief Request queue of a disk.
+ *
+ * Pending requests are kept sorted by LBA and dispatched in one direction across the disk
+ * (C-LOOK), so a sequence of scattered requests is served in a single sweep. Drivers that can
+ * queue commands in the device have up to max_active chains in flight at once.
+ */
+struct disk_queue {
+    const struct disk_queue_ops *ops; /**< Driver operations. */
+    void *driver_data;                /**< Driver data. */
+    int max_sectors;                  /**< Most sectors the driver can transfer with one command. */
+    int max_requests;                 /**< Most requests that can be merged into one command. */
+    int max_active;                   /**< Most chains the driver can transfer at the same time. */
+
+    struct disk_request *pending; /**< Chains waiting to be dispatched, sorted by LBA. */
+    struct disk_request *active;  /**< Chains being transferred, in dispatch order. */
+    int active_count;             /**< Number of chains being transferred. */
+    unsigned int position;        /**< Sector following the last dispatched chain. */
+    int paused;                   /**< Nesting count of disk_queue_pause(), no chain starts while non-zero. */
+    struct spinlock_t lock;       /**< Protects the queue, also taken from the completion interrupt. */
+};
+
+/**
+ * @brief Initializes a request queue.
+ *
+ * @param queue The queue to initialize.
+ * @param ops The driver operations.
+ * @param driver_data Driver data stored in the queue.
+ * @param max_sectors Most sectors the driver can transfer with one command.
+ * @param max_requests Most requests the driver can transfer with one command.
+ * @param max_active Most commands the driver can have in progress at once.
+ */
+void disk_queue_init(struct disk_queue *queue, const struct disk_queue_ops *ops, void *driver_data, int max_sectors,
+                     int max_requests, int max_active);
+
+/**
+ * @brief Initializes a request.
+ *
+ * @param req The request to initialize.
+ * @param lba First sector of the transfer.
+ * @param total Number of sectors, at most the max_sectors of the queue it is submitted to.
+ * @param buf The buffer to transfer to or from.
+ * @param write true to write to the disk, false to read from it.
+ */
+void disk_request_init(struct disk_request *req, unsigned int lba, int total, void *buf, bool write);
+
+/**
+ * @brief Submits a request without waiting for it to complete.
+ *
+ * The request is merged with a queued request for the adjacent sectors if possible, otherwise it
+ * is inserted in LBA order. A request that overlaps a queued one is only submitted once the
+ * earlier request has completed, so transfers of the same sectors are never reordered.
+ *
+ * @param queue The queue to submit to.
+ * @param req The request, which must stay valid until it has completed.
+ * @return 0 on success, error code otherwise.
+ */
+int disk_queue_submit(struct disk_queue *queue, struct disk_request *req);
+
+/**
+ * @brief Waits for a request to complete.
+ *
+ * When there is a current task and preemption is enabled, other tasks run while the transfer is in
+ * progress. Otherwise, the caller polls the driver.
+ *
+ * @param queue The queue the request was submitted to.
+ * @param req The request to wait for.
+ * @return The status of the request.
+ */
+int disk_request_wait(struct disk_queue *queue, struct disk_request *req);
+
+/**
+ * @brief Stops dispatching and waits for the chains in flight to complete.
+ *
+ * Submitted requests stay pending until disk_queue_resume(). Used before the device is accessed
+ * without the queue, such as with programmed I/O, which shares the registers of a DMA command.
+ *
+ * @param queue The queue to pause.
+ */
+void disk_queue_pause(struct disk_queue *queue);
+
+/**
+ * @brief Undoes disk_queue_pause() and dispatches the pending chains.
+ *
+ * @param queue The queue to resume.
+ */
+void disk_queue_resume(struct disk_queue *queue);
+
+/**
+ * @brief Completes an active chain and dispatches the next ones.
+ *
+ * Called by the driver, usually from its interrupt handler.
+ *
+ * @param queue The queue the chain was dispatched from.
+ * @param chain The chain passed to the start operation, which has finished.
+ * @param status 0 on success or an error code, given to every request of the chain.
+ */
+void disk_queue_complete(struct disk_queue *queue, struct disk_request *chain, int status);
+
+#endif
@@ -0,0 +1,117 @@
+#include "ramdisk.h"
+#include "bcache.h"
+#include "config.h"
+#include "disk.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+#include "status.h"
+#include "stdlib/printf.h"
+
+/**
+ * @brief Checks that a range of bytes lies within a disk.
+ *
+ * @param disk The disk.
+ * @param lba The sector the range starts in.
+ * @param end Offset of the end of the range from the start of that sector.
+ * @return true if the range fits, false otherwise.
+ */
+static bool ramdisk_fits(struct disk *disk, unsigned int lba, uint32_t end) {
+    uint32_t sectors = (end + TOYOS_SECTOR_SIZE - 1) / TOYOS_SECTOR_SIZE;
+    return lba < disk->sectors && sectors <= disk->sectors - lba;
+}
+
+int ramdisk_create(void *image, unsigned int sectors) {
+    if (!image || !sectors) {
+        return -EINVARG;
+    }
+
+    struct disk *device = kzalloc(sizeof(struct disk));
+    if (!device) {
+        return -ENOMEM;
+    }
+
+    device->type = DISK_TYPE_RAM;
+    device->sector_size = TOYOS_SECTOR_SIZE;
+    device->sectors = sectors;
+    device->driver_data = image;
+
+    int res = disk_register(device);
+    if (res < 0) {
+        kfree(device);
+    }
+
+    return res;
+}
+
+int ramdisk_load(struct disk *source, unsigned int max_sectors) {
+    if (!source || !source->sectors) {
+        return -EINVARG;
+    }
+
+    if (source->sectors > max_sectors) {
+        return -ENOMEM;
+    }
+
+    // The copy must include what is still waiting in the buffer cache
+    int res = bcache_sync(source);
+    if (res < 0) {
+        return res;
+    }
+
+    char *image = kmalloc(source->sectors * TOYOS_SECTOR_SIZE);
+    if (!image) {
+        return -ENOMEM;
+    }
+
+    res = disk_read_block(source, 0, source->sectors, image);
+    if (res < 0) {
+        goto out;
+    }
+
+    res = ramdisk_create(image, source->sectors);
+    if (res < 0) {
+        goto out;
+    }
+
+    printf("RAM disk: Disk %i holds a copy of disk %i, %i KB\n", res, source->id,
+           source->sectors * TOYOS_SECTOR_SIZE / 1024);
+
+out:
+    if (res < 0) {
+        kfree(image);
+    }
+
+    return res;
+}
+
+int ramdisk_transfer(struct disk *disk, unsigned int lba, int offset, void *buf, int len, bool write) {
+    if (!disk || !buf || offset < 0 || len < 0) {
+        return -EINVARG;
+    }
+
+    uint32_t end = (uint32_t)offset + (uint32_t)len;
+    if (!ramdisk_fits(disk, lba, end)) {
+        return -EIO;
+    }
+
+    if (disk->parent) {
+        lba += disk->lba_offset;
+        disk = disk->parent;
+        if (!ramdisk_fits(disk, lba, end)) {
+            return -EIO;
+        }
+    }
+
+    if (disk->type != DISK_TYPE_RAM) {
+        return -EIO;
+    }
+
+    char *data = (char *)disk->driver_data + lba * TOYOS_SECTOR_SIZE + offset;
+    if (write) {
+        memcpy(data, buf, len);
+    } else {
+        memcpy(buf, data, len);
+    }
+
+    return OK;
+}
@@ -0,0 +1,46 @@
+#ifndef _DISK_RAMDISK_H_
+#define _DISK_RAMDISK_H_
+
+#include <stdbool.h>
+
+// Forward declaration of disk
+struct disk;
+
+/**
+ * @brief Registers a memory image as a disk.
+ *
+ * The image is used in place, and its file system, or the partitions of its master boot record,
+ * are resolved like those of any other device.
+ *
+ * @param image The disk image, which must stay valid.
+ * @param sectors The size of the image in sectors.
+ * @return The index of the disk, or an error code.
+ */
+int ramdisk_create(void *image, unsigned int sectors);
+
+/**
+ * @brief Copies a disk into memory and registers the copy as a disk.
+ *
+ * The whole disk is read with large requests, so a volume of programs can be loaded once at boot
+ * and served from memory afterwards. Writes only change the copy.
+ *
+ * @param source The disk to copy, whose size must be known.
+ * @param max_sectors The largest disk that is copied.
+ * @return The index of the RAM disk, or an error code.
+ */
+int ramdisk_load(struct disk *source, unsigned int max_sectors);
+
+/**
+ * @brief Copies bytes between a RAM disk and a buffer.
+ *
+ * @param disk The RAM disk or one of its partitions.
+ * @param lba The sector the transfer starts in.
+ * @param offset Offset of the first byte within the sector.
+ * @param buf The buffer to copy to or from.
+ * @param len Number of bytes.
+ * @param write true to copy the buffer to the disk, false to copy from the disk.
+ * @return 0 on success, -EIO if the bytes lie outside the disk.
+ */
+int ramdisk_transfer(struct disk *disk, unsigned int lba, int offset, void *buf, int len, bool write);
+
+#endif
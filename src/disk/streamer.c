@@ -1,6 +1,8 @@
 #include "streamer.h"
+#include "bcache.h"
 #include "config.h"
 #include "memory/heap/kheap.h"
+#include "memory/memory.h"
 #include "status.h"
 #include <stdbool.h>
 
@@ -17,6 +19,7 @@ struct disk_stream *streamer_new(int disk_id) {
 
     streamer->pos = 0;
     streamer->disk = disk;
+    streamer->next_pos = -1;
 
     return streamer;
 }
@@ -30,86 +33,152 @@ int streamer_seek(struct disk_stream *stream, int pos) {
     return OK;
 }
 
-int streamer_read(struct disk_stream *stream, void *out, int total) {
-    if (!stream || !out || total < 0) {
-        return -EINVARG;
-    }
+/**
+ * @brief Checks whether the read-ahead window holds a sector.
+ *
+ * @param stream The stream.
+ * @param sector The sector.
+ * @return true if the window holds an up to date copy of the sector.
+ */
+static bool streamer_window_has(struct disk_stream *stream, unsigned int sector) {
+    return stream->window_sectors && stream->window_generation == stream->disk->generation &&
+           sector >= stream->window_lba && sector - stream->window_lba < (unsigned int)stream->window_sectors;
+}
 
-    int sector = stream->pos / TOYOS_SECTOR_SIZE;
-    int offset = stream->pos % TOYOS_SECTOR_SIZE;
-    int total_to_read = total;
-    bool overflow = (offset + total_to_read) >= TOYOS_SECTOR_SIZE;
-    char buf[TOYOS_SECTOR_SIZE];
+/**
+ * @brief Fills the read-ahead window with the sectors from the given one on.
+ *
+ * @param stream The stream.
+ * @param sector The first sector to read.
+ * @return 0 on success, error code otherwise.
+ */
+static int streamer_window_fill(struct disk_stream *stream, unsigned int sector) {
+    if (!stream->window) {
+        stream->window = kmalloc(TOYOS_STREAMER_READAHEAD_SECTORS * TOYOS_SECTOR_SIZE);
+        if (!stream->window) {
+            return -ENOMEM;
+        }
+    }
 
-    if (overflow) {
-        total_to_read -= (offset + total_to_read) - TOYOS_SECTOR_SIZE;
+    // Stop at the end of the disk, if its size is known
+    int count = TOYOS_STREAMER_READAHEAD_SECTORS;
+    unsigned int sectors = stream->disk->sectors;
+    if (sectors && sector < sectors && sectors - sector < (unsigned int)count) {
+        count = sectors - sector;
     }
 
-    int res = disk_read_block(stream->disk, sector, 1, buf);
+    stream->window_sectors = 0;
+    stream->window_generation = stream->disk->generation;
+    int res = bcache_read_sectors(stream->disk, sector, count, stream->window);
     if (res < 0) {
-        goto out;
+        return res;
     }
 
-    // Copy the read data from the buffer to the output
-    for (int i = 0; i < total_to_read; i++) {
-        *(char *)out++ = buf[offset + i];
+    stream->window_lba = sector;
+    stream->window_sectors = count;
+    return OK;
+}
+
+/**
+ * @brief Reads part of a single sector.
+ *
+ * Sequential reads are served from the read-ahead window, others from the buffer cache.
+ *
+ * @param stream The stream, positioned within the sector.
+ * @param out The buffer to copy to.
+ * @param total Number of bytes, which must not cross the end of the sector.
+ * @return 0 on success, error code otherwise.
+ */
+static int streamer_read_partial(struct disk_stream *stream, void *out, int total) {
+    unsigned int sector = stream->pos / TOYOS_SECTOR_SIZE;
+    int offset = stream->pos % TOYOS_SECTOR_SIZE;
+
+    if (!streamer_window_has(stream, sector) && stream->pos == stream->next_pos) {
+        // A failed fill only means the sector is read on its own
+        streamer_window_fill(stream, sector);
     }
 
-    // Update the stream position
-    stream->pos += total_to_read;
-    if (overflow) {
-        res = streamer_read(stream, out, total - total_to_read);
+    if (streamer_window_has(stream, sector)) {
+        memcpy(out, stream->window + (sector - stream->window_lba) * TOYOS_SECTOR_SIZE + offset, total);
+        return OK;
     }
 
-out:
-    return res;
+    return bcache_read(stream->disk, sector, out, offset, total);
 }
 
-int streamer_write(struct disk_stream *stream, const void *in, int total) {
-    if (!stream || !in || total < 0) {
+int streamer_read(struct disk_stream *stream, void *out, int total) {
+    if (!stream || !out || total < 0) {
         return -EINVARG;
     }
 
-    int sector = stream->pos / TOYOS_SECTOR_SIZE;
-    int offset = stream->pos % TOYOS_SECTOR_SIZE;
-    int total_to_write = total;
-    bool overflow = (offset + total_to_write) >= TOYOS_SECTOR_SIZE;
-    char buf[TOYOS_SECTOR_SIZE];
-
-    // If the write spans multiple sectors, handle the overflow
-    if (overflow) {
-        total_to_write -= (offset + total_to_write) - TOYOS_SECTOR_SIZE;
-    }
+    int res = OK;
+    char *ptr = out;
+    while (total > 0) {
+        int offset = stream->pos % TOYOS_SECTOR_SIZE;
+        int count;
+
+        if (offset == 0 && total >= TOYOS_SECTOR_SIZE) {
+            // The aligned middle of the request goes to the caller with a single request
+            int sectors = total / TOYOS_SECTOR_SIZE;
+            count = sectors * TOYOS_SECTOR_SIZE;
+            res = bcache_read_sectors(stream->disk, stream->pos / TOYOS_SECTOR_SIZE, sectors, ptr);
+        } else {
+            count = TOYOS_SECTOR_SIZE - offset < total ? TOYOS_SECTOR_SIZE - offset : total;
+            res = streamer_read_partial(stream, ptr, count);
+        }
 
-    // Read the current sector into the buffer if not writing an entire sector
-    if (offset != 0 || total_to_write != TOYOS_SECTOR_SIZE) {
-        int res = disk_read_block(stream->disk, sector, 1, buf);
         if (res < 0) {
-            goto out;
+            break;
         }
-    }
 
-    // Copy data into the buffer
-    for (int i = 0; i < total_to_write; i++) {
-        buf[offset + i] = *(const char *)in++;
+        ptr += count;
+        total -= count;
+        stream->pos += count;
     }
 
-    // Write the buffer back to the disk
-    int res = disk_write_block(stream->disk, sector, 1, buf);
-    if (res < 0) {
-        goto out;
+    stream->next_pos = stream->pos;
+    return res;
+}
+
+int streamer_write(struct disk_stream *stream, const void *in, int total) {
+    if (!stream || !in || total < 0) {
+        return -EINVARG;
     }
 
-    // Update the stream position
-    stream->pos += total_to_write;
-    if (overflow) {
-        res = streamer_write(stream, in, total - total_to_write);
+    int res = OK;
+    const char *ptr = in;
+    while (total > 0) {
+        unsigned int sector = stream->pos / TOYOS_SECTOR_SIZE;
+        int offset = stream->pos % TOYOS_SECTOR_SIZE;
+        int count;
+
+        if (offset == 0 && total >= TOYOS_SECTOR_SIZE) {
+            // Whole sectors go out with a single request, nothing needs to be read first
+            int sectors = total / TOYOS_SECTOR_SIZE;
+            count = sectors * TOYOS_SECTOR_SIZE;
+            res = bcache_write_sectors(stream->disk, sector, sectors, ptr);
+        } else {
+            // Only a partial head or tail sector is read, by the cache, before it is changed
+            count = TOYOS_SECTOR_SIZE - offset < total ? TOYOS_SECTOR_SIZE - offset : total;
+            res = bcache_write(stream->disk, sector, ptr, offset, count);
+        }
+
+        if (res < 0) {
+            break;
+        }
+
+        ptr += count;
+        total -= count;
+        stream->pos += count;
     }
 
-out:
     return res;
 }
 
 void streamer_close(struct disk_stream *stream) {
+    if (stream->window) {
+        kfree(stream->window);
+    }
+
     kfree(stream);
 }
@@ -5,10 +5,19 @@
 
 /**
  * @brief Structure representing a stream for reading from or writing to a disk.
+ *
+ * Small reads that follow each other are served from a read-ahead window of
+ * TOYOS_STREAMER_READAHEAD_SECTORS sectors, filled with a single disk request.
  */
 struct disk_stream {
     int pos;           /**< Current position in the stream (byte offset). */
     struct disk *disk; /**< Pointer to the disk associated with this stream. */
+
+    int next_pos;                   /**< Position following the previous read, to detect sequential reads. */
+    char *window;                   /**< Read-ahead buffer, allocated on the first sequential read. */
+    unsigned int window_lba;        /**< First sector held by the window. */
+    int window_sectors;             /**< Number of sectors held by the window, 0 if it is empty. */
+    unsigned int window_generation; /**< Write generation of the disk when the window was filled. */
 };
 
 /**
@@ -31,6 +40,9 @@ int streamer_seek(struct disk_stream *stream, int pos);
 /**
  * @brief Reads data from the disk stream into a buffer.
  *
+ * Whole sectors in the middle of the request are read with one multi-sector request straight
+ * into the buffer. Partial sectors come from the read-ahead window or the buffer cache.
+ *
  * @param stream The disk stream to read from.
  * @param out The buffer to store the read data.
  * @param total The number of bytes to read.
@@ -41,6 +53,10 @@ int streamer_read(struct disk_stream *stream, void *out, int total);
 /**
  * @brief Writes data from a buffer to the disk stream.
  *
+ * Whole sectors in the middle of the request are written with one multi-sector request. Partial
+ * head and tail sectors go to the buffer cache and reach the disk when it is synced, see
+ * bcache_sync().
+ *
  * @param stream The disk stream to write to.
  * @param in The buffer containing the data to write.
  * @param total The number of bytes to write.
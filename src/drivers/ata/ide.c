@@ -0,0 +1,347 @@
+#include "ide.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "disk/disk.h"
+#include "disk/queue.h"
+#include "drivers/pci/pci.h"
+#include "idt/idt.h"
+#include "io/io.h"
+#include "kernel.h"
+#include "status.h"
+#include "stdlib/printf.h"
+
+// ATA task file registers, offsets from the command block of a channel
+#define ATA_REG_DATA 0x00
+#define ATA_REG_SECTOR_COUNT 0x02
+#define ATA_REG_LBA_LOW 0x03
+#define ATA_REG_LBA_MID 0x04
+#define ATA_REG_LBA_HIGH 0x05
+#define ATA_REG_DRIVE 0x06
+#define ATA_REG_COMMAND 0x07
+#define ATA_REG_STATUS 0x07
+
+// ATA commands
+#define ATA_CMD_READ_DMA 0xc8
+#define ATA_CMD_WRITE_DMA 0xca
+#define ATA_CMD_IDENTIFY 0xec
+
+// ATA status bits
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_DF 0x20
+#define ATA_STATUS_BSY 0x80
+
+// Selects the master drive in LBA mode, the low nibble holds LBA bits 24-27
+#define ATA_DRIVE_MASTER_LBA 0xe0
+
+// IDENTIFY word 49 bit 8 is set if the drive supports DMA
+#define ATA_IDENTIFY_CAPABILITIES 49
+#define ATA_CAPABILITY_DMA 0x0100
+
+// Bus master registers of the primary channel, offsets from BAR4
+#define IDE_BM_COMMAND 0x00
+#define IDE_BM_STATUS 0x02
+#define IDE_BM_PRDT 0x04
+
+// Bus master command bits
+#define IDE_BM_CMD_START 0x01
+#define IDE_BM_CMD_READ 0x08  // Transfer from the drive to memory
+
+// Bus master status bits, ERROR and IRQ are cleared by writing 1
+#define IDE_BM_STATUS_ACTIVE 0x01
+#define IDE_BM_STATUS_ERROR 0x02
+#define IDE_BM_STATUS_IRQ 0x04
+
+// Legacy resources of the primary channel in compatibility mode
+#define IDE_PRIMARY_COMMAND 0x1f0
+#define IDE_PRIMARY_CONTROL 0x3f6
+#define IDE_PRIMARY_IRQ 14
+
+// Polls of the drive before it is considered hung
+#define IDE_TIMEOUT 10000000
+
+/**
+ * @brief State of an IDE channel
+ *
+ * @var command Base port of the task file registers.
+ * @var control Port of the device control register.
+ * @var bus_master Base port of the bus master registers.
+ * @var irq The IRQ raised by the channel.
+ * @var busy Whether a DMA command is in progress.
+ * @var direction The bus master direction of the command in progress.
+ * @var chain The requests transferred by the command in progress.
+ */
+struct ide_channel {
+    uint16_t command;
+    uint16_t control;
+    uint16_t bus_master;
+    uint8_t irq;
+    volatile bool busy;
+    uint8_t direction;
+    struct disk_request *chain;
+};
+
+static struct ide_channel ide_primary;
+static bool ide_dma_enabled = false;
+
+// Requests for the master drive of the primary channel, one DMA command is in flight at a time
+static struct disk_queue ide_queue;
+
+// The PRD table must be dword aligned and must not cross a 64 KB boundary, aligning it to its own
+// size guarantees both
+static struct ide_prd ide_prd_table[IDE_PRD_ENTRIES]
+    __attribute__((aligned(IDE_PRD_ENTRIES * sizeof(struct ide_prd))));
+
+/**
+ * @brief Waits for the drive to clear its busy bit.
+ *
+ * @return The last status read, or -EIO on timeout.
+ */
+static int ide_wait_not_busy(void) {
+    for (int i = 0; i < IDE_TIMEOUT; i++) {
+        uint8_t status = insb(ide_primary.command + ATA_REG_STATUS);
+        if (!(status & ATA_STATUS_BSY)) {
+            return status;
+        }
+    }
+
+    return -EIO;
+}
+
+/**
+ * @brief Checks with IDENTIFY that the master drive is present and supports DMA.
+ *
+ * @return true if DMA can be used, false otherwise.
+ */
+static bool ide_drive_supports_dma(void) {
+    uint16_t command = ide_primary.command;
+
+    outb(command + ATA_REG_DRIVE, ATA_DRIVE_MASTER_LBA);
+    outb(command + ATA_REG_SECTOR_COUNT, 0);
+    outb(command + ATA_REG_LBA_LOW, 0);
+    outb(command + ATA_REG_LBA_MID, 0);
+    outb(command + ATA_REG_LBA_HIGH, 0);
+    outb(command + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+
+    // A status of 0 means there is no drive
+    if (insb(command + ATA_REG_STATUS) == 0) {
+        return false;
+    }
+
+    int status = ide_wait_not_busy();
+    if (status < 0 || (status & ATA_STATUS_ERR) || !(status & ATA_STATUS_DRQ)) {
+        return false;
+    }
+
+    uint16_t capabilities = 0;
+    for (int i = 0; i < 256; i++) {
+        uint16_t word = insw(command + ATA_REG_DATA);
+        if (i == ATA_IDENTIFY_CAPABILITIES) {
+            capabilities = word;
+        }
+    }
+
+    return capabilities & ATA_CAPABILITY_DMA;
+}
+
+/**
+ * @brief Describes a buffer in the PRD table.
+ *
+ * The kernel is identity mapped, so the address of the buffer is also its physical address.
+ *
+ * @param entries The number of entries in use, updated with the entries added.
+ * @param buf The buffer to describe.
+ * @param size The size of the buffer in bytes.
+ * @return 0 on success, -EINVARG if the buffer needs more entries than the table has left.
+ */
+static int ide_prd_add(int *entries, void *buf, uint32_t size) {
+    uint32_t address = (uint32_t)buf;
+
+    while (size) {
+        if (*entries == IDE_PRD_ENTRIES) {
+            return -EINVARG;
+        }
+
+        // A region ends at the next 64 KB boundary
+        uint32_t length = 0x10000 - (address & 0xffff);
+        if (length > size) {
+            length = size;
+        }
+
+        struct ide_prd *prd = &ide_prd_table[(*entries)++];
+        prd->address = address;
+        prd->count = (uint16_t)length;
+        prd->flags = 0;
+
+        address += length;
+        size -= length;
+    }
+
+    return OK;
+}
+
+/**
+ * @brief Starts one DMA command for a chain of requests with consecutive sectors.
+ *
+ * Each request of the chain gets its own PRD regions, so merged requests are transferred into
+ * their own buffers by a single command.
+ *
+ * @param queue The request queue of the drive.
+ * @param chain The first request of the chain.
+ * @return 0 if the command was started, error code otherwise.
+ */
+static int ide_start(struct disk_queue *queue, struct disk_request *chain) {
+    uint16_t command = ide_primary.command;
+    uint16_t bus_master = ide_primary.bus_master;
+
+    int entries = 0;
+    int total = 0;
+    for (struct disk_request *req = chain; req; req = req->merged) {
+        int res = ide_prd_add(&entries, req->buf, req->total * TOYOS_SECTOR_SIZE);
+        if (res < 0) {
+            return res;
+        }
+
+        total += req->total;
+    }
+
+    ide_prd_table[entries - 1].flags = IDE_PRD_END;
+
+    if (ide_wait_not_busy() < 0) {
+        return -EIO;
+    }
+
+    // Load the PRD table and clear the previous completion before starting
+    ide_primary.direction = chain->write ? 0 : IDE_BM_CMD_READ;
+    ide_primary.chain = chain;
+    outb(bus_master + IDE_BM_COMMAND, ide_primary.direction);
+    outl(bus_master + IDE_BM_PRDT, (uint32_t)ide_prd_table);
+    outb(bus_master + IDE_BM_STATUS, IDE_BM_STATUS_ERROR | IDE_BM_STATUS_IRQ);
+    ide_primary.busy = true;
+
+    unsigned int lba = chain->lba;
+    outb(command + ATA_REG_DRIVE, ATA_DRIVE_MASTER_LBA | ((lba >> 24) & 0x0f));
+    outb(command + ATA_REG_SECTOR_COUNT, (uint8_t)total);
+    outb(command + ATA_REG_LBA_LOW, (uint8_t)(lba & 0xff));
+    outb(command + ATA_REG_LBA_MID, (uint8_t)(lba >> 8));
+    outb(command + ATA_REG_LBA_HIGH, (uint8_t)(lba >> 16));
+    outb(command + ATA_REG_COMMAND, chain->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+    outb(bus_master + IDE_BM_COMMAND, ide_primary.direction | IDE_BM_CMD_START);
+    return OK;
+}
+
+/**
+ * @brief Completes the DMA command in progress if the drive has raised its interrupt.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @return true if a command was completed, false otherwise.
+ */
+static bool ide_check_completion(void) {
+    uint16_t bus_master = ide_primary.bus_master;
+    uint8_t status = insb(bus_master + IDE_BM_STATUS);
+    if (!ide_primary.busy || !(status & IDE_BM_STATUS_IRQ)) {
+        return false;
+    }
+
+    // Stop the engine, then reading the drive status acknowledges the interrupt
+    outb(bus_master + IDE_BM_COMMAND, ide_primary.direction);
+    outb(bus_master + IDE_BM_STATUS, status | IDE_BM_STATUS_ERROR | IDE_BM_STATUS_IRQ);
+    uint8_t drive_status = insb(ide_primary.command + ATA_REG_STATUS);
+    ide_primary.busy = false;
+
+    bool failed = (status & IDE_BM_STATUS_ERROR) || (drive_status & (ATA_STATUS_ERR | ATA_STATUS_DF));
+    disk_queue_complete(&ide_queue, ide_primary.chain, failed ? -EIO : OK);
+    return true;
+}
+
+/**
+ * @brief Handles the interrupt raised by the drive when a command completes.
+ *
+ * @param frame The interrupt frame.
+ */
+static void ide_interrupt(struct interrupt_frame *frame) {
+    if (!ide_check_completion()) {
+        // Programmed I/O commands raise the interrupt too, reading the status acknowledges it
+        insb(ide_primary.command + ATA_REG_STATUS);
+    }
+}
+
+/**
+ * @brief Polls for completion on behalf of a waiter that cannot switch to another task.
+ *
+ * @param queue The request queue of the drive.
+ */
+static void ide_poll(struct disk_queue *queue) {
+    uint32_t flags = cpu_irq_save();
+    ide_check_completion();
+    cpu_irq_restore(flags);
+}
+
+static const struct disk_queue_ops ide_queue_ops = {
+    .start = ide_start,
+    .poll = ide_poll,
+};
+
+int ide_init(struct pci_device *dev) {
+    if (!dev || !(dev->prog_if & IDE_PROG_IF_BUS_MASTER)) {
+        return -EINVARG;
+    }
+
+    // The bus master registers must be in I/O space
+    if (!(dev->bar[4] & 0x1)) {
+        return -EIO;
+    }
+
+    ide_primary.bus_master = dev->bar[4] & 0xfffc;
+    if (dev->prog_if & IDE_PROG_IF_PRIMARY_NATIVE) {
+        ide_primary.command = dev->bar[0] & 0xfffc;
+        ide_primary.control = (dev->bar[1] & 0xfffc) + 2;
+        ide_primary.irq = dev->interrupt_line;
+    } else {
+        ide_primary.command = IDE_PRIMARY_COMMAND;
+        ide_primary.control = IDE_PRIMARY_CONTROL;
+        ide_primary.irq = IDE_PRIMARY_IRQ;
+    }
+
+    // Programmed I/O to the slave would disturb a DMA command in progress on the same channel
+    if (disk_get_ata(1)) {
+        printf("IDE: Primary channel has a slave drive, using PIO\n");
+        return -EBUSY;
+    }
+
+    if (!ide_drive_supports_dma()) {
+        printf("IDE: Drive does not support DMA, using PIO\n");
+        return -EIO;
+    }
+
+    // Let the controller access memory on its own
+    uint32_t cmd = pci_config_read_32(dev->bus, dev->device, dev->function, PCI_COMMAND_OFFSET);
+    cmd |= PCI_COMMAND_IO | PCI_COMMAND_MASTER;
+    cmd &= ~PCI_COMMAND_INTX_DISABLE;
+    pci_config_write_32(dev->bus, dev->device, dev->function, PCI_COMMAND_OFFSET, cmd);
+
+    int res = idt_register_shared_irq_callback(ide_primary.irq, ide_interrupt);
+    if (res < 0) {
+        return res;
+    }
+
+    // Clear nIEN so the drive raises its interrupt on completion
+    outb(ide_primary.control, 0);
+
+    disk_queue_init(&ide_queue, &ide_queue_ops, &ide_primary, IDE_DMA_MAX_SECTORS, IDE_PRD_ENTRIES / 2, 1);
+    ide_dma_enabled = true;
+
+    // The boot disk is the master drive of the primary channel
+    struct disk *disk = disk_get_ata(0);
+    if (disk) {
+        disk->queue = &ide_queue;
+    }
+
+    printf("IDE: Bus master DMA at I/O 0x%x, IRQ %i\n", ide_primary.bus_master, ide_primary.irq);
+    return OK;
+}
+
+bool ide_dma_available(void) {
+    return ide_dma_enabled;
+}
@@ -0,0 +1,64 @@
+#ifndef _IDE_H_
+#define _IDE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declaration of pci_device
+struct pci_device;
+
+// PCI programming interface bits of an IDE controller
+#define IDE_PROG_IF_PRIMARY_NATIVE 0x01  // Primary channel uses the PCI BARs instead of the legacy ports
+#define IDE_PROG_IF_BUS_MASTER 0x80      // Controller supports bus master DMA
+
+/**
+ * @brief Number of entries in the physical region descriptor (PRD) table.
+ *
+ * A request needs at most two regions, so up to half this many merged requests fit in one command.
+ */
+#define IDE_PRD_ENTRIES 32
+
+/**
+ * @brief Most sectors moved by one DMA command (64 KB, so at most two PRD regions).
+ */
+#define IDE_DMA_MAX_SECTORS 128
+
+/**
+ * @brief Physical region descriptor
+ *
+ * Describes one physically contiguous memory region for the bus master engine. A region may not
+ * cross a 64 KB boundary, and a byte count of 0 means 64 KB.
+ *
+ * @var address The physical address of the region, which must be word aligned.
+ * @var count The size of the region in bytes.
+ * @var flags IDE_PRD_END on the last entry of the table.
+ */
+struct ide_prd {
+    uint32_t address;
+    uint16_t count;
+    uint16_t flags;
+} __attribute__((packed));
+
+#define IDE_PRD_END 0x8000
+
+/**
+ * @brief Initializes bus master DMA on a PCI IDE controller
+ *
+ * Sets up the primary channel of the controller for DMA transfers to and from its master drive,
+ * registers the completion interrupt and gives the boot disk a request queue served by DMA.
+ * Until this succeeds, disk I/O uses programmed I/O. DMA is not used when the primary channel also
+ * has a slave drive, whose programmed I/O would disturb a command in progress.
+ *
+ * @param dev The PCI IDE controller.
+ * @return 0 on success, error code otherwise.
+ */
+int ide_init(struct pci_device *dev);
+
+/**
+ * @brief Checks whether DMA transfers are available
+ *
+ * @return true once ide_init() has set up a controller, false otherwise.
+ */
+bool ide_dma_available(void);
+
+#endif
@@ -55,10 +55,14 @@ struct keyboard ps2_keyboard = {.name = {"ps2"}, .init = ps2_keyboard_init};
  *
  * This function enables the first PS/2 port, preparing it for keyboard input.
  *
- * @return Returns OK (0) on successful initialization.
+ * @return Returns OK (0) on successful initialization, error code if the keyboard interrupt is taken.
  */
 int ps2_keyboard_init(void) {
-    idt_register_interrupt_callback(PS2_ISR_KEYBOARD_INTERRUPT, ps2_keyboard_handle_interrupt);
+    int res = idt_register_interrupt_callback(PS2_ISR_KEYBOARD_INTERRUPT, ps2_keyboard_handle_interrupt);
+    if (res < 0) {
+        return res;
+    }
+
     keyboard_set_capslock(&ps2_keyboard, KEYBOARD_CAPS_LOCK_OFF);
 
     // Enable the first PS/2 port
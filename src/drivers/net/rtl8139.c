@@ -285,7 +285,6 @@ static void rtl8139_init_ring(struct rtl8139 *rtl) {
     int i;
 
     rtl->dirty_tx = rtl->cur_tx = 0;
-    rtl->tx_lock.locked = 0;
 
     for (i = 0; i < NUM_TX_DESC; i++) {
         rtl->tx_bufs[i] = NULL;
@@ -574,7 +573,9 @@ static void rtl8139_interrupt(struct interrupt_frame *frame) {
 
         // Handle transmit interrupts
         if (status & (TxOK | TxErr)) {
+            spin_lock(&rtl->tx_lock);
             rtl8139_tx_clear(rtl);
+            spin_unlock(&rtl->tx_lock);
         }
 
         // Handle errors
@@ -603,8 +604,13 @@ int rtl8139_open(struct netdev *dev) {
     struct rtl8139 *rtl = (struct rtl8139 *)dev->driver_data;
     int rx_buf_len_idx = RX_BUF_LEN_IDX;
 
-    // Register interrupt handler (IRQ numbers start at 0x20)
-    idt_register_interrupt_callback(0x20 + rtl->irq, rtl8139_interrupt);
+    // Register interrupt handler (IRQ numbers start at 0x20), PCI devices may share the line
+    int res = idt_register_shared_irq_callback(rtl->irq, rtl8139_interrupt);
+    if (res < 0) {
+        printf("%s: IRQ %i is not available\n", dev->name, rtl->irq);
+        return res;
+    }
+
     printf("%s: Registered interrupt handler for IRQ %i (vector 0x%x)\n", dev->name, rtl->irq, 0x20 + rtl->irq);
 
     // Allocate receive ring buffer:
@@ -694,9 +700,10 @@ int rtl8139_transmit(struct netdev *dev, struct netbuf *buf) {
     int entry;
     uint32_t len = buf->len;
 
-    // TODO: Implement proper synchronization when needed
-    // For now, just use a simple check
+    // The interrupt handler reclaims descriptors under the same lock
+    uint32_t flags = spin_lock_irqsave(&rtl->tx_lock);
     if (rtl->cur_tx - rtl->dirty_tx >= NUM_TX_DESC) {
+        spin_unlock_irqrestore(&rtl->tx_lock, flags);
         printf("%s: Transmit queue full, dropping packet\n", dev->name);
         dev->stats.tx_dropped++;
         return -1;
@@ -717,6 +724,7 @@ int rtl8139_transmit(struct netdev *dev, struct netbuf *buf) {
 
     rtl->trans_start = 0;  // TODO: get current time when timer system is ready
     rtl->cur_tx++;
+    spin_unlock_irqrestore(&rtl->tx_lock, flags);
 
     dev->stats.tx_packets++;
     dev->stats.tx_bytes += len;
@@ -771,6 +779,7 @@ int rtl8139_init(struct pci_device *pci_dev) {
     rtl->duplex_lock = 0;
     rtl->max_interrupt_work = max_interrupt_work;
     rtl->multicast_filter_limit = multicast_filter_limit;
+    spin_lock_init(&rtl->tx_lock, "rtl8139_tx");
 
     // Initialize PHY addresses
     rtl->phys[0] = 32;  // Use internal registers
@@ -1,5 +1,7 @@
 #include "pci.h"
+#include "drivers/ata/ide.h"
 #include "drivers/net/rtl8139.h"
+#include "drivers/virtio/virtio_blk.h"
 #include "io/io.h"
 #include "kernel.h"
 #include "stdlib/printf.h"
@@ -26,10 +28,11 @@
 #define PCI_INTERRUPT_PIN 0x3D
 
 // Special Values
-#define PCI_INVALID_VENDOR 0xFFFF  // Invalid vendor ID
-#define PCI_MAX_BUS 256            // Maximum number of buses
-#define PCI_MAX_DEVICE 32          // Maximum devices per bus
-#define PCI_MAX_FUNCTION 8         // Maximum functions per device
+#define PCI_INVALID_VENDOR 0xFFFF      // Invalid vendor ID
+#define PCI_MAX_BUS 256                // Maximum number of buses
+#define PCI_MAX_DEVICE 32              // Maximum devices per bus
+#define PCI_MAX_FUNCTION 8             // Maximum functions per device
+#define PCI_HEADER_MULTIFUNCTION 0x80  // Header type bit set if the device has more than function 0
 
 // Target Device IDs
 #define RTL8139_VENDOR_ID 0x10EC  // RealTek
@@ -240,6 +243,44 @@ void pci_config_write_32(uint8_t bus, uint8_t device, uint8_t function, uint8_t
     outl(PCI_CONFIG_DATA, value);
 }
 
+/**
+ * @brief Record a discovered function and start its driver
+ *
+ * @param device The device information read from configuration space
+ */
+static void pci_add_device(struct pci_device *device) {
+    if (pci_device_count >= PCI_MAX_DEVICES) {
+        return;
+    }
+
+    pci_devices[pci_device_count] = *device;
+    struct pci_device *dev = &pci_devices[pci_device_count];
+    pci_device_count++;
+
+    printf("PCI %x:%x.%x - %x:%x (%s)\n", dev->bus, dev->device, dev->function, dev->vendor_id, dev->device_id,
+           pci_get_class_name(dev->class_code));
+
+    if (dev->vendor_id == RTL8139_VENDOR_ID && dev->device_id == RTL8139_DEVICE_ID) {
+        printf("    Initializing RTL8139 driver...\n");
+        if (rtl8139_init(dev) == 0) {
+            printf("    RTL8139 driver initialized successfully\n");
+        } else {
+            printf("    RTL8139 driver initialization failed\n");
+        }
+    }
+
+    // Only the first IDE controller drives the disk
+    if (dev->class_code == PCI_CLASS_MASS_STORAGE && dev->subclass == PCI_SUBCLASS_IDE && !ide_dma_available()) {
+        printf("    Initializing IDE bus master DMA...\n");
+        ide_init(dev);
+    }
+
+    if (dev->vendor_id == VIRTIO_VENDOR_ID && dev->device_id == VIRTIO_BLK_DEVICE_ID) {
+        printf("    Initializing virtio-blk driver...\n");
+        virtio_blk_init(dev);
+    }
+}
+
 int pci_enumerate_devices(void) {
     struct pci_device device;
     pci_device_count = 0;
@@ -247,23 +288,22 @@ int pci_enumerate_devices(void) {
     for (int bus = 0; bus < PCI_MAX_BUS; bus++) {
         for (int dev = 0; dev < PCI_MAX_DEVICE; dev++) {
             // Check function 0 first
-            if (pci_read_device_info(bus, dev, 0, &device) == 0) {
-                pci_devices[pci_device_count] = device;
-                pci_device_count++;
-
-                printf("PCI %x:%x.%x - %x:%x (%s)\n", device.bus, device.device, device.function, device.vendor_id,
-                       device.device_id, pci_get_class_name(device.class_code));
-
-                if (device.vendor_id == RTL8139_VENDOR_ID && device.device_id == RTL8139_DEVICE_ID) {
-                    printf("    Initializing RTL8139 driver...\n");
-                    if (rtl8139_init(&pci_devices[pci_device_count - 1]) == 0) {
-                        printf("    RTL8139 driver initialized successfully\n");
-                    } else {
-                        printf("    RTL8139 driver initialization failed\n");
-                    }
-                }
+            if (pci_read_device_info(bus, dev, 0, &device) != 0) {
+                continue;
+            }
+
+            pci_add_device(&device);
 
-                // todo: handle multifunction device, check other functions
+            // Other functions exist only on multifunction devices, such as the IDE controller of a
+            // PCI to ISA bridge
+            if (!(device.header_type & PCI_HEADER_MULTIFUNCTION)) {
+                continue;
+            }
+
+            for (int function = 1; function < PCI_MAX_FUNCTION; function++) {
+                if (pci_read_device_info(bus, dev, function, &device) == 0) {
+                    pci_add_device(&device);
+                }
             }
         }
     }
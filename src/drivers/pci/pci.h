@@ -11,6 +11,10 @@
 #define PCI_COMMAND_MASTER 0x0004        // Enable bus mastering
 #define PCI_COMMAND_INTX_DISABLE 0x0400  // Disable INTx interrupts
 
+// PCI Class Codes
+#define PCI_CLASS_MASS_STORAGE 0x01  // Mass storage controller
+#define PCI_SUBCLASS_IDE 0x01        // IDE controller
+
 /**
  * @brief PCI device information structure
  *
@@ -0,0 +1,361 @@
+#include "virtio_blk.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "disk/disk.h"
+#include "disk/queue.h"
+#include "drivers/pci/pci.h"
+#include "idt/idt.h"
+#include "io/io.h"
+#include "kernel.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+#include "status.h"
+#include "stdlib/printf.h"
+
+// Registers of the legacy interface, offsets from BAR0
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES 0x04
+#define VIRTIO_REG_QUEUE_ADDRESS 0x08  // Page frame number of the virtqueue
+#define VIRTIO_REG_QUEUE_SIZE 0x0c
+#define VIRTIO_REG_QUEUE_SELECT 0x0e
+#define VIRTIO_REG_QUEUE_NOTIFY 0x10
+#define VIRTIO_REG_DEVICE_STATUS 0x12
+#define VIRTIO_REG_ISR_STATUS 0x13     // Reading it acknowledges the interrupt
+#define VIRTIO_REG_BLK_CAPACITY 0x14   // Number of sectors, 64 bits
+
+// Device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+
+// The legacy interface places the used ring on the page following the descriptors and avail ring
+#define VIRTIO_QUEUE_ALIGN 4096
+
+// Most virtio block devices driven at once
+#define VIRTIO_BLK_MAX_DEVICES 2
+
+/**
+ * @brief State of one request in flight, indexed by the first descriptor of its chain.
+ *
+ * @var header The request header read by the device.
+ * @var status The status byte written by the device.
+ * @var chain The disk requests transferred by the request.
+ */
+struct virtio_blk_slot {
+    struct virtio_blk_header header;
+    volatile uint8_t status;
+    struct disk_request *chain;
+};
+
+/**
+ * @brief State of a virtio block device
+ *
+ * Descriptors, rings and slots are only touched with interrupts disabled, either from the queue
+ * operations, which run with the queue lock held, or from the interrupt handler.
+ */
+struct virtio_blk {
+    uint16_t iobase;
+    uint8_t irq;
+    uint64_t capacity;
+
+    uint16_t size;  // Number of descriptors in the virtqueue
+    struct virtq_desc *desc;
+    struct virtq_avail *avail;
+    struct virtq_used *used;
+    struct virtio_blk_slot *slots;
+
+    uint16_t free_head;  // Unused descriptors, linked through their next field
+    uint16_t free_count;
+    uint16_t last_used;  // Used ring entries consumed so far
+
+    struct disk_queue queue;
+    struct disk disk;
+};
+
+static struct virtio_blk *virtio_blk_devices[VIRTIO_BLK_MAX_DEVICES];
+static int virtio_blk_count = 0;
+
+/**
+ * @brief Takes a descriptor from the free list.
+ *
+ * @param blk The device, which must have a free descriptor.
+ * @return The index of the descriptor.
+ */
+static uint16_t virtio_blk_alloc_desc(struct virtio_blk *blk) {
+    uint16_t index = blk->free_head;
+    blk->free_head = blk->desc[index].next;
+    blk->free_count--;
+    return index;
+}
+
+/**
+ * @brief Returns the descriptors of a chain to the free list.
+ *
+ * @param blk The device.
+ * @param head The first descriptor of the chain.
+ */
+static void virtio_blk_free_chain(struct virtio_blk *blk, uint16_t head) {
+    uint16_t index = head;
+    for (;;) {
+        struct virtq_desc *desc = &blk->desc[index];
+        bool last = !(desc->flags & VIRTQ_DESC_F_NEXT);
+        uint16_t next = desc->next;
+
+        desc->flags = 0;
+        desc->next = blk->free_head;
+        blk->free_head = index;
+        blk->free_count++;
+
+        if (last) {
+            break;
+        }
+
+        index = next;
+    }
+}
+
+/**
+ * @brief Turns a chain of disk requests into one virtio-blk request and notifies the device.
+ *
+ * The chain is described by a header descriptor, one descriptor per disk request and a status
+ * descriptor. The queue never has more chains in flight than the virtqueue has descriptors for.
+ *
+ * @param queue The request queue of the device.
+ * @param chain The first request of the chain.
+ * @return 0 if the request was made available to the device, error code otherwise.
+ */
+static int virtio_blk_start(struct disk_queue *queue, struct disk_request *chain) {
+    struct virtio_blk *blk = queue->driver_data;
+
+    int segments = 0;
+    int total = 0;
+    for (struct disk_request *req = chain; req; req = req->merged) {
+        segments++;
+        total += req->total;
+    }
+
+    if (chain->lba + (uint64_t)total > blk->capacity) {
+        return -EIO;
+    }
+
+    if (blk->free_count < segments + 2) {
+        return -EBUSY;
+    }
+
+    uint16_t head = virtio_blk_alloc_desc(blk);
+    struct virtio_blk_slot *slot = &blk->slots[head];
+    slot->header.type = chain->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    slot->header.reserved = 0;
+    slot->header.sector = chain->lba;
+    slot->status = 0xff;
+    slot->chain = chain;
+
+    // The kernel is identity mapped, so buffer addresses are also physical addresses
+    blk->desc[head].address = (uint32_t)&slot->header;
+    blk->desc[head].length = sizeof(struct virtio_blk_header);
+    blk->desc[head].flags = VIRTQ_DESC_F_NEXT;
+
+    uint16_t prev = head;
+    for (struct disk_request *req = chain; req; req = req->merged) {
+        uint16_t index = virtio_blk_alloc_desc(blk);
+        blk->desc[index].address = (uint32_t)req->buf;
+        blk->desc[index].length = req->total * TOYOS_SECTOR_SIZE;
+        blk->desc[index].flags = VIRTQ_DESC_F_NEXT | (chain->write ? 0 : VIRTQ_DESC_F_WRITE);
+        blk->desc[prev].next = index;
+        prev = index;
+    }
+
+    uint16_t status = virtio_blk_alloc_desc(blk);
+    blk->desc[status].address = (uint32_t)&slot->status;
+    blk->desc[status].length = 1;
+    blk->desc[status].flags = VIRTQ_DESC_F_WRITE;
+    blk->desc[prev].next = status;
+
+    // The descriptors must be visible before the ring entry, and the entry before the index
+    blk->avail->ring[blk->avail->idx % blk->size] = head;
+    __sync_synchronize();
+    blk->avail->idx++;
+    __sync_synchronize();
+    outw(blk->iobase + VIRTIO_REG_QUEUE_NOTIFY, 0);
+    return OK;
+}
+
+/**
+ * @brief Completes every request the device has returned in the used ring.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * @param blk The device.
+ */
+static void virtio_blk_complete_used(struct virtio_blk *blk) {
+    while (blk->last_used != *(volatile uint16_t *)&blk->used->idx) {
+        __sync_synchronize();
+        struct virtq_used_elem *elem = &blk->used->ring[blk->last_used % blk->size];
+        uint16_t head = (uint16_t)elem->id;
+        blk->last_used++;
+
+        struct virtio_blk_slot *slot = &blk->slots[head];
+        struct disk_request *chain = slot->chain;
+        int status = slot->status == VIRTIO_BLK_S_OK ? OK : -EIO;
+        slot->chain = NULL;
+
+        // Free the descriptors first, completing the chain may start the next one
+        virtio_blk_free_chain(blk, head);
+        disk_queue_complete(&blk->queue, chain, status);
+    }
+}
+
+/**
+ * @brief Handles the interrupt raised when the device returns requests.
+ *
+ * @param frame The interrupt frame.
+ */
+static void virtio_blk_interrupt(struct interrupt_frame *frame) {
+    for (int i = 0; i < virtio_blk_count; i++) {
+        struct virtio_blk *blk = virtio_blk_devices[i];
+        insb(blk->iobase + VIRTIO_REG_ISR_STATUS);
+        virtio_blk_complete_used(blk);
+    }
+}
+
+/**
+ * @brief Polls for completions on behalf of a waiter that cannot switch to another task.
+ *
+ * @param queue The request queue of the device.
+ */
+static void virtio_blk_poll(struct disk_queue *queue) {
+    uint32_t flags = cpu_irq_save();
+    virtio_blk_complete_used(queue->driver_data);
+    cpu_irq_restore(flags);
+}
+
+static const struct disk_queue_ops virtio_blk_queue_ops = {
+    .start = virtio_blk_start,
+    .poll = virtio_blk_poll,
+};
+
+/**
+ * @brief Allocates the virtqueue of the device and hands it over.
+ *
+ * @param blk The device, with queue 0 selected.
+ * @return 0 on success, error code otherwise.
+ */
+static int virtio_blk_setup_queue(struct virtio_blk *blk) {
+    blk->size = insw(blk->iobase + VIRTIO_REG_QUEUE_SIZE);
+    if (blk->size < 3) {
+        return -EIO;
+    }
+
+    uint32_t avail_offset = sizeof(struct virtq_desc) * blk->size;
+    uint32_t used_offset = avail_offset + sizeof(uint16_t) * (3 + blk->size);
+    used_offset = (used_offset + VIRTIO_QUEUE_ALIGN - 1) & ~(VIRTIO_QUEUE_ALIGN - 1);
+    uint32_t used_size = sizeof(uint16_t) * 3 + sizeof(struct virtq_used_elem) * blk->size;
+
+    // Heap allocations are page aligned, as the device requires
+    char *memory = kzalloc(used_offset + used_size);
+    if (!memory) {
+        return -ENOMEM;
+    }
+
+    blk->slots = kzalloc(sizeof(struct virtio_blk_slot) * blk->size);
+    if (!blk->slots) {
+        kfree(memory);
+        return -ENOMEM;
+    }
+
+    blk->desc = (struct virtq_desc *)memory;
+    blk->avail = (struct virtq_avail *)(memory + avail_offset);
+    blk->used = (struct virtq_used *)(memory + used_offset);
+
+    for (uint16_t i = 0; i < blk->size; i++) {
+        blk->desc[i].next = i + 1;
+    }
+
+    blk->free_head = 0;
+    blk->free_count = blk->size;
+    blk->last_used = 0;
+
+    outl(blk->iobase + VIRTIO_REG_QUEUE_ADDRESS, (uint32_t)memory / VIRTIO_QUEUE_ALIGN);
+    return OK;
+}
+
+int virtio_blk_init(struct pci_device *dev) {
+    if (!dev || !(dev->bar[0] & 0x1)) {
+        return -EINVARG;
+    }
+
+    if (virtio_blk_count >= VIRTIO_BLK_MAX_DEVICES) {
+        return -ENOMEM;
+    }
+
+    struct virtio_blk *blk = kzalloc(sizeof(struct virtio_blk));
+    if (!blk) {
+        return -ENOMEM;
+    }
+
+    blk->iobase = dev->bar[0] & 0xfffc;
+    blk->irq = dev->interrupt_line;
+
+    uint32_t cmd = pci_config_read_32(dev->bus, dev->device, dev->function, PCI_COMMAND_OFFSET);
+    cmd |= PCI_COMMAND_IO | PCI_COMMAND_MASTER;
+    cmd &= ~PCI_COMMAND_INTX_DISABLE;
+    pci_config_write_32(dev->bus, dev->device, dev->function, PCI_COMMAND_OFFSET, cmd);
+
+    // Reset, then announce a driver that uses none of the optional features
+    outb(blk->iobase + VIRTIO_REG_DEVICE_STATUS, 0);
+    outb(blk->iobase + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(blk->iobase + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    insl(blk->iobase + VIRTIO_REG_DEVICE_FEATURES);
+    outl(blk->iobase + VIRTIO_REG_GUEST_FEATURES, 0);
+
+    blk->capacity = insl(blk->iobase + VIRTIO_REG_BLK_CAPACITY);
+    blk->capacity |= (uint64_t)insl(blk->iobase + VIRTIO_REG_BLK_CAPACITY + 4) << 32;
+
+    outw(blk->iobase + VIRTIO_REG_QUEUE_SELECT, 0);
+    int res = virtio_blk_setup_queue(blk);
+    if (res < 0) {
+        goto out;
+    }
+
+    res = idt_register_shared_irq_callback(blk->irq, virtio_blk_interrupt);
+    if (res < 0) {
+        goto out;
+    }
+
+    // Every chain in flight needs a header and a status descriptor besides its data
+    int segments = blk->size - 2 < VIRTIO_BLK_MAX_SEGMENTS ? blk->size - 2 : VIRTIO_BLK_MAX_SEGMENTS;
+    int max_active = blk->size / (segments + 2);
+    disk_queue_init(&blk->queue, &virtio_blk_queue_ops, blk, VIRTIO_BLK_MAX_SECTORS, segments, max_active);
+
+    virtio_blk_devices[virtio_blk_count++] = blk;
+    outb(blk->iobase + VIRTIO_REG_DEVICE_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+    blk->disk.type = DISK_TYPE_VIRTIO;
+    blk->disk.sector_size = TOYOS_SECTOR_SIZE;
+    blk->disk.queue = &blk->queue;
+
+    // Sectors past 32 bits cannot be addressed by the disk layer, the rest of a larger disk is left out
+    blk->disk.sectors = blk->capacity > 0xffffffff ? 0xffffffff : (unsigned int)blk->capacity;
+    res = disk_register(&blk->disk);
+    if (res < 0) {
+        // The device stays set up, it is just not reachable as a disk
+        printf("virtio-blk: No room for another disk\n");
+        return res;
+    }
+
+    printf("virtio-blk: Disk %i, %i sectors at I/O 0x%x, IRQ %i, %i requests in flight\n", res,
+           blk->disk.sectors, blk->iobase, blk->irq, max_active);
+    return res;
+
+out:
+    // A reset makes the device let go of the virtqueue
+    outb(blk->iobase + VIRTIO_REG_DEVICE_STATUS, 0);
+    if (blk->desc) {
+        kfree(blk->desc);
+        kfree(blk->slots);
+    }
+
+    kfree(blk);
+    return res;
+}
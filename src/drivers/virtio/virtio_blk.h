@@ -0,0 +1,101 @@
+#ifndef _VIRTIO_BLK_H_
+#define _VIRTIO_BLK_H_
+
+#include <stdint.h>
+
+// Forward declaration of pci_device
+struct pci_device;
+
+// PCI identification of a transitional (legacy interface) virtio block device
+#define VIRTIO_VENDOR_ID 0x1af4
+#define VIRTIO_BLK_DEVICE_ID 0x1001
+
+/**
+ * @brief Most sectors moved by one virtio-blk request (128 KB).
+ */
+#define VIRTIO_BLK_MAX_SECTORS 256
+
+/**
+ * @brief Most disk requests merged into one virtio-blk request.
+ *
+ * Each one takes a descriptor of the virtqueue, in addition to the header and status descriptors.
+ */
+#define VIRTIO_BLK_MAX_SEGMENTS 16
+
+/**
+ * @brief Virtqueue descriptor
+ *
+ * @var address The physical address of the buffer.
+ * @var length The size of the buffer in bytes.
+ * @var flags VIRTQ_DESC_F_* flags.
+ * @var next The index of the next descriptor of the chain, if VIRTQ_DESC_F_NEXT is set.
+ */
+struct virtq_desc {
+    uint64_t address;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+#define VIRTQ_DESC_F_NEXT 0x1   // The chain continues with the next field
+#define VIRTQ_DESC_F_WRITE 0x2  // The device writes to the buffer
+
+/**
+ * @brief Ring of descriptor chains made available to the device
+ */
+struct virtq_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed));
+
+/**
+ * @brief Descriptor chain the device has finished with
+ *
+ * @var id The index of the first descriptor of the chain.
+ * @var length The number of bytes the device wrote.
+ */
+struct virtq_used_elem {
+    uint32_t id;
+    uint32_t length;
+} __attribute__((packed));
+
+/**
+ * @brief Ring of descriptor chains returned by the device
+ */
+struct virtq_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct virtq_used_elem ring[];
+} __attribute__((packed));
+
+/**
+ * @brief Header of a virtio-blk request
+ *
+ * @var type VIRTIO_BLK_T_IN to read, VIRTIO_BLK_T_OUT to write.
+ * @var reserved Must be 0.
+ * @var sector The first sector of the transfer.
+ */
+struct virtio_blk_header {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed));
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_S_OK 0
+
+/**
+ * @brief Initializes a virtio block device and registers it as a disk
+ *
+ * The device gets a request queue that keeps several requests in flight on its virtqueue and
+ * completes them from its interrupt. It is registered after the disks found before it, so the
+ * first virtio disk is usually 1:/.
+ *
+ * @param dev The PCI virtio block device.
+ * @return The index of the disk on success, error code otherwise.
+ */
+int virtio_blk_init(struct pci_device *dev);
+
+#endif
@@ -1,5 +1,6 @@
 #include "fat16.h"
 #include "config.h"
+#include "disk/bcache.h"
 #include "disk/disk.h"
 #include "disk/streamer.h"
 #include "kernel.h"
@@ -7,14 +8,18 @@
 #include "memory/memory.h"
 #include "status.h"
 #include "stdlib/string.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 // FAT16 specific constants and definitions
 #define TOYOS_FAT16_SIGNATURE 0x29
 #define TOYOS_FAT16_FAT_ENTRY_SIZE 0x02
-#define TOYOS_FAT16_BAD_SECTOR 0xff7
+#define TOYOS_FAT16_BAD_SECTOR 0xfff7
 #define TOYOS_FAT16_UNUSED 0x00
+#define TOYOS_FAT16_RESERVED 0xfff0     // First value that is not a cluster number
+#define TOYOS_FAT16_END_OF_CHAIN 0xfff8 // Entries from here on end a chain
+#define TOYOS_FAT16_END_OF_CHAIN_MARK 0xffff
 
 // FAT directory entry attributes bitmask
 #define FAT_FILE_READ_ONLY 0x01
@@ -107,6 +112,7 @@ struct fat_directory {
     int total;                       /**< Total number of items in the directory */
     int sector_pos;                  /**< Starting sector of the directory */
     int ending_sector_pos;           /**< Ending sector of the directory */
+    int first_cluster;               /**< First cluster of a subdirectory, 0 for the root directory */
 };
 
 /**
@@ -121,13 +127,25 @@ struct fat_item {
     fat_item_type type; /**< Type of the item (file or directory) */
 };
 
+/**
+ * @struct fat_chain_cursor
+ * @brief A resolved position in a cluster chain, so the next lookup can continue from it.
+ */
+struct fat_chain_cursor {
+    int first;      /**< First cluster of the chain, or 0 if nothing is resolved yet */
+    uint32_t index; /**< Index of the resolved cluster within the chain */
+    int cluster;    /**< The resolved cluster */
+};
+
 /**
  * @struct fat_file_descriptor
  * @brief Descriptor for open files in FAT16, tracks the position within the file.
  */
 struct fat_file_descriptor {
-    struct fat_item *item; /**< Associated FAT item */
-    uint32_t pos;          /**< Current position within the file */
+    struct fat_item *item;         /**< Associated FAT item */
+    uint32_t pos;                  /**< Current position within the file */
+    struct fat_chain_cursor chain; /**< Last cluster looked up in the file */
+    int entry_pos;                 /**< Byte position of the file's directory entry on the disk */
 };
 
 /**
@@ -144,6 +162,17 @@ struct fat_private {
 
     // Stream for directory data
     struct disk_stream *directory_stream;
+
+    // In-memory copy of the first FAT, handed to the buffer cache for every copy once a write is done
+    uint16_t *fat_table;   /**< Entries of the FAT */
+    uint32_t fat_entries;  /**< Number of entries in the FAT */
+    bool *fat_dirty;       /**< One flag per FAT sector, set when it changed since it was last handed over */
+
+    // Free clusters, kept in step with the FAT
+    uint32_t *free_bitmap;  /**< One bit per cluster, set when the cluster is free */
+    uint32_t cluster_count; /**< Number of FAT entries that describe clusters, including the first two */
+    uint32_t free_clusters; /**< Number of free clusters */
+    uint32_t next_free;     /**< Cluster the search for free clusters starts from */
 };
 
 // Function declarations for FAT16 filesystem operations
@@ -154,6 +183,8 @@ int fat16_write(struct disk *disk, void *private_data, uint32_t size, uint32_t n
 int fat16_seek(void *private_data, uint32_t offset, file_seek_mode seek_mode);
 int fat16_stat(struct disk *disk, void *private_data, struct file_stat *stat);
 int fat16_close(void *private_data);
+int fat16_sync(struct disk *disk);
+int fat16_statfs(struct disk *disk, struct file_statfs *stat);
 
 /**
  * @brief FAT16 filesystem structure with function pointers to filesystem operations.
@@ -164,7 +195,9 @@ struct filesystem fat16_fs = {.resolve = fat16_resolve,
                               .write = fat16_write,
                               .seek = fat16_seek,
                               .stat = fat16_stat,
-                              .close = fat16_close};
+                              .close = fat16_close,
+                              .sync = fat16_sync,
+                              .statfs = fat16_statfs};
 
 struct filesystem *fat16_init(void) {
     strcpy(fat16_fs.name, "FAT16");
@@ -303,6 +336,68 @@ err_out:
     return res;
 }
 
+/**
+ * @brief Reads the first FAT into memory, so chain walks and updates do not touch the disk.
+ * @param disk Pointer to the disk structure.
+ * @param private Pointer to the FAT16 private structure.
+ * @return Status code indicating success or failure.
+ */
+static int fat16_load_fat(struct disk *disk, struct fat_private *private) {
+    struct fat_header *primary_header = &private->header.primary_header;
+    uint32_t sectors = primary_header->sectors_per_fat;
+    if (!sectors || !primary_header->fat_copies) {
+        return -EFSNOTUS;
+    }
+
+    uint32_t size = sectors * disk->sector_size;
+    private->fat_table = kmalloc(size);
+    private->fat_dirty = kzalloc(sectors * sizeof(bool));
+    if (!private->fat_table || !private->fat_dirty) {
+        return -ENOMEM;
+    }
+
+    private->fat_entries = size / TOYOS_FAT16_FAT_ENTRY_SIZE;
+
+    // The whole table is read with one request
+    struct disk_stream *stream = private->fat_read_stream;
+    if (!stream || streamer_seek(stream, primary_header->reserved_sectors * disk->sector_size) != OK ||
+        streamer_read(stream, private->fat_table, size) != OK) {
+        return -EIO;
+    }
+
+    // Clusters start after the root directory, and the FAT may have entries past the last one
+    uint32_t total_sectors = primary_header->number_of_sectors ? primary_header->number_of_sectors
+                                                               : primary_header->sectors_big;
+    uint32_t data_start = private->root_directory.ending_sector_pos;
+    if (!primary_header->sectors_per_cluster || total_sectors <= data_start) {
+        return -EFSNOTUS;
+    }
+
+    private->cluster_count = (total_sectors - data_start) / primary_header->sectors_per_cluster + 2;
+    if (private->cluster_count > private->fat_entries) {
+        private->cluster_count = private->fat_entries;
+    }
+
+    if (private->cluster_count > TOYOS_FAT16_RESERVED) {
+        private->cluster_count = TOYOS_FAT16_RESERVED;
+    }
+
+    private->free_bitmap = kzalloc((private->cluster_count + 31) / 32 * sizeof(uint32_t));
+    if (!private->free_bitmap) {
+        return -ENOMEM;
+    }
+
+    for (uint32_t cluster = 2; cluster < private->cluster_count; cluster++) {
+        if (private->fat_table[cluster] == TOYOS_FAT16_UNUSED) {
+            private->free_bitmap[cluster / 32] |= 1u << (cluster % 32);
+            private->free_clusters++;
+        }
+    }
+
+    private->next_free = 2;
+    return OK;
+}
+
 /**
  * @brief Resolves the FAT16 filesystem on the given disk.
  * @param disk Pointer to the disk structure.
@@ -341,12 +436,46 @@ int fat16_resolve(struct disk *disk) {
         goto out;
     }
 
+    res = fat16_load_fat(disk, fat_private);
+    if (res < 0) {
+        goto out;
+    }
+
 out:
     if (stream) {
         streamer_close(stream);
     }
 
     if (res < 0) {
+        if (fat_private->fat_table) {
+            kfree(fat_private->fat_table);
+        }
+
+        if (fat_private->fat_dirty) {
+            kfree(fat_private->fat_dirty);
+        }
+
+        if (fat_private->free_bitmap) {
+            kfree(fat_private->free_bitmap);
+        }
+
+        if (fat_private->root_directory.item) {
+            kfree(fat_private->root_directory.item);
+        }
+
+        // Every disk without a FAT16 file system gets here, so nothing may be left behind
+        if (fat_private->cluster_read_stream) {
+            streamer_close(fat_private->cluster_read_stream);
+        }
+
+        if (fat_private->fat_read_stream) {
+            streamer_close(fat_private->fat_read_stream);
+        }
+
+        if (fat_private->directory_stream) {
+            streamer_close(fat_private->directory_stream);
+        }
+
         kfree(fat_private);
         disk->fs_private = NULL;
     }
@@ -404,55 +533,132 @@ static uint32_t fat16_get_first_fat_sector(struct fat_private *private) {
 }
 
 /**
- * @brief Retrieves a FAT table entry for a given cluster.
- * @param disk Pointer to the disk structure.
+ * @brief Checks whether a FAT entry ends a cluster chain.
+ * @param entry FAT table entry value.
+ * @return true if the entry marks the last cluster of a chain.
+ */
+static bool fat16_is_end_of_chain(int entry) {
+    return entry >= TOYOS_FAT16_END_OF_CHAIN;
+}
+
+/**
+ * @brief Checks whether a cluster is free according to the free-cluster bitmap.
+ * @param private Pointer to the FAT16 private structure.
  * @param cluster Cluster number.
- * @return FAT table entry value.
+ * @return true if the cluster is free.
  */
-static int fat16_get_fat_entry(struct disk *disk, int cluster) {
-    int res = -100;
-    struct fat_private *private = disk->fs_private;
-    struct disk_stream *stream = private->fat_read_stream;
-    if (!stream) {
-        goto out;
+static bool fat16_cluster_is_free(struct fat_private *private, uint32_t cluster) {
+    return cluster < private->cluster_count && (private->free_bitmap[cluster / 32] & (1u << (cluster % 32)));
+}
+
+/**
+ * @brief Records in the free-cluster bitmap whether a cluster is free.
+ * @param private Pointer to the FAT16 private structure.
+ * @param cluster Cluster number.
+ * @param free true if the cluster is now free.
+ */
+static void fat16_mark_cluster(struct fat_private *private, uint32_t cluster, bool free) {
+    if (cluster < 2 || cluster >= private->cluster_count || fat16_cluster_is_free(private, cluster) == free) {
+        return;
     }
 
-    uint32_t fat_table_position = fat16_get_first_fat_sector(private) * disk->sector_size;
-    res = streamer_seek(stream, fat_table_position + (cluster * TOYOS_FAT16_FAT_ENTRY_SIZE));
-    if (res < 0) {
-        goto out;
+    if (free) {
+        private->free_bitmap[cluster / 32] |= 1u << (cluster % 32);
+        private->free_clusters++;
+    } else {
+        private->free_bitmap[cluster / 32] &= ~(1u << (cluster % 32));
+        private->free_clusters--;
     }
+}
 
-    uint16_t result = 0;
-    res = streamer_read(stream, &result, sizeof(result));
-    if (res < 0) {
-        goto out;
+/**
+ * @brief Looks for a run of free clusters within a range of the bitmap.
+ * @param private Pointer to the FAT16 private structure.
+ * @param start First cluster to look at.
+ * @param end Cluster after the last one to look at.
+ * @param count Length of the run wanted.
+ * @param best Receives the first cluster of the longest run seen, which is updated across calls.
+ * @param best_length Length of the longest run seen, which is updated across calls.
+ * @return true once a run of count clusters is found, in best.
+ */
+static bool fat16_scan_free(struct fat_private *private, uint32_t start, uint32_t end, uint32_t count,
+                            uint32_t *best, uint32_t *best_length) {
+    uint32_t run_length = 0;
+    uint32_t cluster = start;
+    while (cluster < end) {
+        // Words without a free cluster are skipped whole
+        if (!run_length && cluster % 32 == 0 && !private->free_bitmap[cluster / 32]) {
+            cluster += 32;
+            continue;
+        }
+
+        if (!fat16_cluster_is_free(private, cluster)) {
+            run_length = 0;
+            cluster++;
+            continue;
+        }
+
+        run_length++;
+        if (run_length > *best_length) {
+            *best = cluster + 1 - run_length;
+            *best_length = run_length;
+        }
+
+        if (run_length >= count) {
+            return true;
+        }
+
+        cluster++;
     }
 
-    res = result;
+    return false;
+}
 
-out:
-    return res;
+/**
+ * @brief Retrieves a FAT table entry for a given cluster.
+ * @param disk Pointer to the disk structure.
+ * @param cluster Cluster number.
+ * @return FAT table entry value.
+ */
+static int fat16_get_fat_entry(struct disk *disk, int cluster) {
+    struct fat_private *private = disk->fs_private;
+    if (cluster < 0 || (uint32_t)cluster >= private->fat_entries) {
+        return -EIO;
+    }
+
+    return private->fat_table[cluster];
 }
 
 /**
  * @brief Finds the cluster corresponding to a given offset in a file.
+ *
+ * The walk continues from the cursor when it lies at or before the wanted cluster, so sequential
+ * accesses follow one FAT entry per cluster instead of walking from the start of the chain.
+ *
  * @param disk Pointer to the disk structure.
  * @param starting_cluster Starting cluster of the file.
  * @param offset Byte offset within the file.
+ * @param cursor Last resolved position in the chain, updated on success, or NULL.
  * @return Cluster number or error code.
  */
-static int fat16_get_cluster_for_offset(struct disk *disk, int starting_cluster, int offset) {
+static int fat16_get_cluster_for_offset(struct disk *disk, int starting_cluster, int offset,
+                                        struct fat_chain_cursor *cursor) {
     int res = 0;
     struct fat_private *private = disk->fs_private;
 
     int size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
     int cluster_to_use = starting_cluster;
     int clusters_ahead = offset / size_of_cluster_bytes;
+    int i = 0;
+
+    if (cursor && cursor->first == starting_cluster && cursor->index <= (uint32_t)clusters_ahead) {
+        cluster_to_use = cursor->cluster;
+        i = cursor->index;
+    }
 
-    for (int i = 0; i < clusters_ahead; i++) {
+    for (; i < clusters_ahead; i++) {
         int entry = fat16_get_fat_entry(disk, cluster_to_use);
-        if (entry == 0xff8 || entry == 0xfff) {
+        if (fat16_is_end_of_chain(entry)) {
             // We are at the last entry in the file
             res = -EIO;
             goto out;
@@ -463,7 +669,7 @@ static int fat16_get_cluster_for_offset(struct disk *disk, int starting_cluster,
             goto out;
         }
 
-        if (entry == 0xff0 || entry == 0xff6) {
+        if (entry >= TOYOS_FAT16_RESERVED) {
             // reserved sector
             res = -EIO;
             goto out;
@@ -479,6 +685,11 @@ static int fat16_get_cluster_for_offset(struct disk *disk, int starting_cluster,
     }
 
     res = cluster_to_use;
+    if (cursor) {
+        cursor->first = starting_cluster;
+        cursor->index = clusters_ahead;
+        cursor->cluster = cluster_to_use;
+    }
 
 out:
     return res;
@@ -486,46 +697,70 @@ out:
 
 /**
  * @brief Reads data from a FAT16 filesystem into a buffer using a disk stream.
+ *
+ * Clusters that follow each other on the disk are read together, so the streamer can transfer
+ * their whole sectors with one request straight into the buffer.
+ *
  * @param disk Pointer to the disk structure.
  * @param stream Pointer to the disk stream.
  * @param cluster Starting cluster of the file.
  * @param offset Offset within the file.
  * @param total Total bytes to read.
  * @param out Output buffer.
+ * @param cursor Last resolved position in the chain, or NULL.
  * @return Number of bytes read or error code.
  */
 static int fat16_read_internal_from_stream(struct disk *disk, struct disk_stream *stream, int cluster, int offset,
-                                           int total, void *out) {
+                                           int total, void *out, struct fat_chain_cursor *cursor) {
     int res = 0;
     struct fat_private *private = disk->fs_private;
+    struct fat_chain_cursor local_cursor = {0};
+    if (!cursor) {
+        cursor = &local_cursor;
+    }
 
     int size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
-    int cluster_to_use = fat16_get_cluster_for_offset(disk, cluster, offset);
-    if (cluster_to_use < 0) {
-        res = cluster_to_use;
-        goto out;
-    }
+    while (total > 0) {
+        int cluster_to_use = fat16_get_cluster_for_offset(disk, cluster, offset, cursor);
+        if (cluster_to_use < 0) {
+            res = cluster_to_use;
+            goto out;
+        }
 
-    int starting_sector = fat16_cluster_to_sector(private, cluster_to_use);
-    int offset_from_cluster = offset % size_of_cluster_bytes;
-    int starting_pos = (starting_sector * disk->sector_size) + offset_from_cluster;
-    int total_to_read = total > size_of_cluster_bytes ? size_of_cluster_bytes : total;
+        int starting_sector = fat16_cluster_to_sector(private, cluster_to_use);
+        int offset_from_cluster = offset % size_of_cluster_bytes;
+        int starting_pos = (starting_sector * disk->sector_size) + offset_from_cluster;
+        int total_to_read = size_of_cluster_bytes - offset_from_cluster;
 
-    res = streamer_seek(stream, starting_pos);
-    if (res != OK) {
-        goto out;
-    }
+        // Extend the read over the following clusters as long as they are the next ones on the disk
+        while (total_to_read < total) {
+            int entry = fat16_get_fat_entry(disk, cursor->cluster);
+            if (entry != cursor->cluster + 1) {
+                break;
+            }
 
-    res = streamer_read(stream, out, total_to_read);
-    if (res != OK) {
-        goto out;
-    }
+            cursor->index++;
+            cursor->cluster = entry;
+            total_to_read += size_of_cluster_bytes;
+        }
 
-    total -= total_to_read;
-    if (total > 0) {
-        // still more to read so recursively call this function
-        res =
-            fat16_read_internal_from_stream(disk, stream, cluster, offset + total_to_read, total, out + total_to_read);
+        if (total_to_read > total) {
+            total_to_read = total;
+        }
+
+        res = streamer_seek(stream, starting_pos);
+        if (res != OK) {
+            goto out;
+        }
+
+        res = streamer_read(stream, out, total_to_read);
+        if (res != OK) {
+            goto out;
+        }
+
+        total -= total_to_read;
+        offset += total_to_read;
+        out = (char *)out + total_to_read;
     }
 
 out:
@@ -539,13 +774,15 @@ out:
  * @param offset Offset within the file.
  * @param total Total bytes to read.
  * @param out Output buffer.
+ * @param cursor Last resolved position in the chain, or NULL.
  * @return Number of bytes read or error code.
  */
-static int fat16_read_internal(struct disk *disk, int starting_cluster, int offset, int total, void *out) {
+static int fat16_read_internal(struct disk *disk, int starting_cluster, int offset, int total, void *out,
+                               struct fat_chain_cursor *cursor) {
     struct fat_private *fs_private = disk->fs_private;
     struct disk_stream *stream = fs_private->cluster_read_stream;
 
-    return fat16_read_internal_from_stream(disk, stream, starting_cluster, offset, total, out);
+    return fat16_read_internal_from_stream(disk, stream, starting_cluster, offset, total, out, cursor);
 }
 
 /**
@@ -601,6 +838,7 @@ struct fat_directory *fat16_load_fat_directory(struct disk *disk, struct fat_dir
 
     int cluster = fat16_get_first_cluster(item);
     int cluster_sector = fat16_cluster_to_sector(fat_private, cluster);
+    directory->first_cluster = cluster;
 
     directory->total = fat16_get_total_items_for_directory(disk, cluster_sector);
     int directory_size = directory->total * sizeof(struct fat_directory_item);
@@ -613,7 +851,7 @@ struct fat_directory *fat16_load_fat_directory(struct disk *disk, struct fat_dir
     }
 
     // read the directory into memory
-    res = fat16_read_internal(disk, cluster, 0x00, directory_size, directory->item);
+    res = fat16_read_internal(disk, cluster, 0x00, directory_size, directory->item, NULL);
     if (res != OK) {
         goto out;
     }
@@ -694,40 +932,77 @@ void fat16_get_full_relative_filename(struct fat_directory_item *item, char *out
     }
 }
 
+/**
+ * @brief Gets the position of a directory entry on the disk.
+ * @param disk Pointer to the disk structure.
+ * @param directory Pointer to the directory holding the entry.
+ * @param index Index of the entry within the directory.
+ * @return Absolute byte position of the entry or error code.
+ */
+static int fat16_get_entry_position(struct disk *disk, struct fat_directory *directory, int index) {
+    struct fat_private *private = disk->fs_private;
+    int offset = index * sizeof(struct fat_directory_item);
+
+    // The root directory is a contiguous run of sectors, a subdirectory follows its cluster chain
+    if (!directory->first_cluster) {
+        return fat16_sector_to_absolute(disk, directory->sector_pos) + offset;
+    }
+
+    int cluster = fat16_get_cluster_for_offset(disk, directory->first_cluster, offset, NULL);
+    if (cluster < 0) {
+        return cluster;
+    }
+
+    int cluster_size = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    return fat16_sector_to_absolute(disk, fat16_cluster_to_sector(private, cluster)) + offset % cluster_size;
+}
+
 /**
  * @brief Finds a FAT16 item in a directory by its name.
  * @param disk Pointer to the disk structure.
  * @param directory Pointer to the directory structure.
  * @param name Name of the item to find.
+ * @param entry_pos Set to the byte position of the item's directory entry on the disk, or NULL.
  * @return Pointer to the found item structure.
  */
-struct fat_item *fat16_find_item_in_directory(struct disk *disk, struct fat_directory *directory, const char *name) {
-    struct fat_item *f_item = NULL;
+struct fat_item *fat16_find_item_in_directory(struct disk *disk, struct fat_directory *directory, const char *name,
+                                              int *entry_pos) {
     char tmp_filename[TOYOS_MAX_PATH];
 
     for (int i = 0; i < directory->total; i++) {
         fat16_get_full_relative_filename(&directory->item[i], tmp_filename, sizeof(tmp_filename));
+        if (istrncmp(tmp_filename, name, sizeof(tmp_filename)) != 0) {
+            continue;
+        }
 
-        if (istrncmp(tmp_filename, name, sizeof(tmp_filename)) == 0) {
-            // Found it let's create a new fat_item
-            f_item = fat16_new_fat_item_for_directory_item(disk, &directory->item[i]);
+        int pos = fat16_get_entry_position(disk, directory, i);
+        if (pos < 0) {
+            return NULL;
         }
+
+        if (entry_pos) {
+            *entry_pos = pos;
+        }
+
+        // Found it let's create a new fat_item
+        return fat16_new_fat_item_for_directory_item(disk, &directory->item[i]);
     }
 
-    return f_item;
+    return NULL;
 }
 
 /**
  * @brief Retrieves the FAT16 item for a directory entry from a given path.
  * @param disk Pointer to the disk structure.
  * @param path Pointer to the parsed path structure.
+ * @param entry_pos Set to the byte position of the item's directory entry on the disk.
  * @return Pointer to the found FAT16 item structure.
  */
-struct fat_item *fat16_get_directory_entry(struct disk *disk, struct path_part *path) {
+struct fat_item *fat16_get_directory_entry(struct disk *disk, struct path_part *path, int *entry_pos) {
     struct fat_private *fat_private = disk->fs_private;
     struct fat_item *current_item = 0;
 
-    struct fat_item *root_item = fat16_find_item_in_directory(disk, &fat_private->root_directory, path->part);
+    struct fat_item *root_item = fat16_find_item_in_directory(disk, &fat_private->root_directory, path->part, entry_pos);
     if (!root_item) {
         return NULL;
     }
@@ -741,7 +1016,7 @@ struct fat_item *fat16_get_directory_entry(struct disk *disk, struct path_part *
             return NULL;
         }
 
-        struct fat_item *tmp_item = fat16_find_item_in_directory(disk, current_item->directory, next_part->part);
+        struct fat_item *tmp_item = fat16_find_item_in_directory(disk, current_item->directory, next_part->part, entry_pos);
         if (!tmp_item) {
             return NULL;
         }
@@ -769,108 +1044,105 @@ static int fat16_set_fat_entry(struct disk *disk, int cluster, int value) {
     }
 
     struct fat_private *private = disk->fs_private;
-    struct disk_stream *stream = private->fat_read_stream;
-    if (!stream) {
-        return -EIO;
-    }
-
-    uint32_t fat_table_position = fat16_get_first_fat_sector(private) * disk->sector_size;
-    if (streamer_seek(stream, fat_table_position + (cluster * TOYOS_FAT16_FAT_ENTRY_SIZE)) != OK) {
-        return -EIO;
-    }
-
-    uint16_t entry = value;
-    if (streamer_write(stream, &entry, sizeof(entry)) != OK) {
+    if (cluster < 0 || (uint32_t)cluster >= private->fat_entries) {
         return -EIO;
     }
 
+    // Only the memory copy changes, the sector is handed to the buffer cache when the write is done
+    private->fat_table[cluster] = value;
+    fat16_mark_cluster(private, cluster, value == TOYOS_FAT16_UNUSED);
+    private->fat_dirty[cluster * TOYOS_FAT16_FAT_ENTRY_SIZE / disk->sector_size] = true;
     return OK;
 }
 
 /**
- * @brief Allocates a new cluster in the FAT table.
+ * @brief Hands the modified sectors of the in-memory FAT to the buffer cache, for every FAT copy.
+ *
+ * The sectors are then written back along with the file data and directory entries that refer to
+ * them, by the periodic write-back or a sync.
+ *
  * @param disk Pointer to the disk structure.
- * @param current_cluster Current cluster number.
- * @return The new cluster number or an error code.
+ * @return Status code indicating success or failure.
  */
-static int fat16_allocate_cluster(struct disk *disk, int current_cluster) {
-    if (!disk) {
-        return -EINVARG;
-    }
-
-    struct fat_private *fs_private = disk->fs_private;
+static int fat16_flush_fat(struct disk *disk) {
+    struct fat_private *private = disk->fs_private;
+    struct fat_header *primary_header = &private->header.primary_header;
 
-    // Find a free cluster
-    for (int i = 2; i < fs_private->header.primary_header.number_of_sectors; i++) {
-        int entry = fat16_get_fat_entry(disk, i);
-        if (entry == TOYOS_FAT16_UNUSED) {
-            // Mark the new cluster as used and link it to the current cluster
-            if (fat16_set_fat_entry(disk, current_cluster, i) != OK) {
-                return -EIO;
-            }
+    for (uint32_t sector = 0; sector < primary_header->sectors_per_fat; sector++) {
+        if (!private->fat_dirty[sector]) {
+            continue;
+        }
 
-            if (fat16_set_fat_entry(disk, i, 0xfff) != OK) {
+        char *data = (char *)private->fat_table + sector * disk->sector_size;
+        for (int copy = 0; copy < primary_header->fat_copies; copy++) {
+            uint32_t lba = fat16_get_first_fat_sector(private) + copy * primary_header->sectors_per_fat + sector;
+            if (bcache_write(disk, lba, data, 0, disk->sector_size) < 0) {
                 return -EIO;
             }
-
-            return i;
         }
+
+        private->fat_dirty[sector] = false;
     }
 
-    return -ENOMEM;
+    return OK;
 }
 
 /**
- * @brief Gets the sector number for a given directory item.
- * @param private Pointer to the FAT16 private structure.
- * @param item Pointer to the directory item.
- * @return Sector number or an error code.
+ * @brief Allocates clusters and appends them to a chain.
+ *
+ * The search starts right after the end of the chain when that cluster is free, so a growing file
+ * stays contiguous, and from the next-free hint otherwise. A run long enough for every cluster is
+ * preferred. If there is none, the longest run found is allocated and the caller asks again once
+ * it reaches the end of it.
+ *
+ * @param disk Pointer to the disk structure.
+ * @param current_cluster Last cluster of the chain, or 0 to start a new chain.
+ * @param count Number of clusters wanted.
+ * @return The first new cluster or an error code.
  */
-static int fat16_get_directory_sector(struct fat_private *private, struct fat_directory_item *item) {
-    if (!item || !private) {
+static int fat16_allocate_clusters(struct disk *disk, int current_cluster, uint32_t count) {
+    if (!disk || !count) {
         return -EINVARG;
     }
 
-    if (item->attribute & FAT_FILE_SUBDIRECTORY) {
-        // For subdirectories, calculate the sector based on the cluster
-        int cluster = fat16_get_first_cluster(item);
-        return fat16_cluster_to_sector(private, cluster);
+    struct fat_private *fs_private = disk->fs_private;
+    uint32_t start = fs_private->next_free;
+    if (current_cluster && fat16_cluster_is_free(fs_private, current_cluster + 1)) {
+        start = current_cluster + 1;
     }
 
-    // For the root directory, return the starting sector of the root directory
-    struct fat_header *primary_header = &private->header.primary_header;
-    int root_dir_sector =
-        primary_header->reserved_sectors + (primary_header->fat_copies * primary_header->sectors_per_fat);
-    return root_dir_sector;
-}
+    if (start < 2 || start >= fs_private->cluster_count) {
+        start = 2;
+    }
 
-/**
- * @brief Gets the offset within a directory for a given item.
- * @param private Pointer to the FAT16 private structure.
- * @param item Pointer to the directory item.
- * @return Offset or an error code.
- */
-static int fat16_get_directory_offset(struct fat_private *private, struct fat_directory_item *item) {
-    if (!item || !private) {
-        return -EINVARG;
+    uint32_t first = 0;
+    uint32_t length = 0;
+    if (!fat16_scan_free(fs_private, start, fs_private->cluster_count, count, &first, &length)) {
+        fat16_scan_free(fs_private, 2, start, count, &first, &length);
     }
 
-    // For subdirectories, the offset is within the cluster
-    if (item->attribute & FAT_FILE_SUBDIRECTORY) {
-        // Subdirectories start at the beginning of their cluster
-        return 0;
+    if (!length) {
+        return -ENOMEM;
+    }
+
+    if (length > count) {
+        length = count;
     }
 
-    // For the root directory, calculate the offset based on the item's position
-    struct fat_directory *root_directory = &private->root_directory;
-    for (int i = 0; i < root_directory->total; i++) {
-        if (&root_directory->item[i] == item) {
-            return i * sizeof(struct fat_directory_item);
+    // Link the new clusters to each other, then to the end of the chain
+    for (uint32_t i = 0; i < length; i++) {
+        int value = i + 1 < length ? (int)(first + i + 1) : TOYOS_FAT16_END_OF_CHAIN_MARK;
+        if (fat16_set_fat_entry(disk, first + i, value) != OK) {
+            return -EIO;
         }
     }
 
-    // Item not found in the root directory
-    return -EIO;
+    if (current_cluster && fat16_set_fat_entry(disk, current_cluster, first) != OK) {
+        return -EIO;
+    }
+
+    fs_private->next_free = first + length;
+    return first;
 }
 
 /**
@@ -898,7 +1170,7 @@ void *fat16_open(struct disk *disk, struct path_part *path, file_mode mode) {
         return ERROR(-ENOMEM);
     }
 
-    descriptor->item = fat16_get_directory_entry(disk, path);
+    descriptor->item = fat16_get_directory_entry(disk, path, &descriptor->entry_pos);
     if (!descriptor->item) {
         err_code = -EIO;
         goto err_out;
@@ -927,20 +1199,28 @@ int fat16_read(struct disk *disk, void *private_data, uint32_t size, uint32_t nm
     }
 
     struct fat_file_descriptor *descriptor = private_data;
+    if (descriptor->item->type == FAT_ITEM_TYPE_DIRECTORY) {
+        return -EINVARG;
+    }
+
+    // The request is read as a whole and stops at the end of the file
     struct fat_directory_item *item = descriptor->item->item;
-    int offset = descriptor->pos;
+    uint32_t total = size * nmemb;
+    if (descriptor->pos >= item->filesize) {
+        return 0;
+    }
 
-    for (int i = 0; i < nmemb; i++) {
-        int res = fat16_read_internal(disk, fat16_get_first_cluster(item), offset, size, out);
-        if (res < 0) {
-            return 0;
-        }
+    if (total > item->filesize - descriptor->pos) {
+        total = item->filesize - descriptor->pos;
+    }
 
-        offset += size;
-        offset += res;
+    int res = fat16_read_internal(disk, fat16_get_first_cluster(item), descriptor->pos, total, out, &descriptor->chain);
+    if (res < 0) {
+        return 0;
     }
 
-    return nmemb;
+    descriptor->pos += total;
+    return total / size;
 }
 
 /**
@@ -1043,19 +1323,41 @@ int fat16_write(struct disk *disk, void *private_data, uint32_t size, uint32_t n
     uint32_t bytes_written = 0;
     int cluster = fat16_get_first_cluster(item);
     int offset = descriptor->pos;
+    int cluster_size = fs_private->header.primary_header.sectors_per_cluster * disk->sector_size;
+
+    // An empty file has no clusters yet, its chain starts with this write
+    if (!cluster && total_bytes > 0) {
+        cluster = fat16_allocate_clusters(disk, 0, (total_bytes + cluster_size - 1) / cluster_size);
+        if (cluster < 0) {
+            return cluster;
+        }
+
+        item->high_16_bits_first_cluster = 0;
+        item->low_16_bits_first_cluster = cluster;
+    }
 
     while (total_bytes > 0) {
-        int current_cluster = fat16_get_cluster_for_offset(disk, cluster, offset);
+        int current_cluster = fat16_get_cluster_for_offset(disk, cluster, offset, &descriptor->chain);
+        if (current_cluster < 0 && offset > 0 && offset % cluster_size == 0) {
+            // The data so far ends with the last cluster, so the chain grows by the clusters for the rest
+            // at once, which lets them be contiguous
+            int last_cluster = fat16_get_cluster_for_offset(disk, cluster, offset - 1, &descriptor->chain);
+            if (last_cluster >= 0 && fat16_is_end_of_chain(fat16_get_fat_entry(disk, last_cluster))) {
+                uint32_t clusters = (total_bytes + cluster_size - 1) / cluster_size;
+                current_cluster = fat16_allocate_clusters(disk, last_cluster, clusters);
+            }
+        }
+
         if (current_cluster < 0) {
-            return -EIO;
+            return current_cluster;
         }
 
-        // Calculate the sector to write to
+        // Write up to the end of the cluster at once, so the streamer can send whole sectors together
         int starting_sector = fat16_cluster_to_sector(fs_private, current_cluster);
-        int offset_from_cluster = offset % (fs_private->header.primary_header.sectors_per_cluster * disk->sector_size);
+        int offset_from_cluster = offset % cluster_size;
         int starting_pos = (starting_sector * disk->sector_size) + offset_from_cluster;
-        int bytes_to_write = total_bytes > (disk->sector_size - offset_from_cluster)
-                                 ? (disk->sector_size - offset_from_cluster)
+        int bytes_to_write = total_bytes > (uint32_t)(cluster_size - offset_from_cluster)
+                                 ? (cluster_size - offset_from_cluster)
                                  : total_bytes;
 
         // Write to the disk
@@ -1071,40 +1373,19 @@ int fat16_write(struct disk *disk, void *private_data, uint32_t size, uint32_t n
         total_bytes -= bytes_to_write;
         bytes_written += bytes_to_write;
         offset += bytes_to_write;
-
-        // If we reach the end of the current cluster, get the next cluster
-        if (offset_from_cluster + bytes_to_write >=
-            disk->sector_size * fs_private->header.primary_header.sectors_per_cluster) {
-            int next_cluster = fat16_get_fat_entry(disk, current_cluster);
-
-            if (next_cluster == 0xfff || next_cluster == 0xff8) {
-                // Allocate a new cluster if necessary
-                next_cluster = fat16_allocate_cluster(disk, current_cluster);
-                if (next_cluster < 0) {
-                    return -EIO;
-                }
-            }
-
-            cluster = next_cluster;
-        }
     }
 
     if (descriptor->pos + bytes_written > item->filesize) {
         item->filesize = descriptor->pos + bytes_written;
     }
 
-    // Update the directory entry on the disk
-    int dir_sector = fat16_get_directory_sector(fs_private, item);
-    if (dir_sector < 0) {
+    // The clusters the directory entry points to must be in the FAT by the time it is written back
+    if (fat16_flush_fat(disk) != OK) {
         return -EIO;
     }
 
-    int dir_offset = fat16_get_directory_offset(fs_private, item);
-    if (dir_offset < 0) {
-        return -EIO;
-    }
-
-    if (streamer_seek(fs_private->directory_stream, dir_sector * disk->sector_size + dir_offset) != OK) {
+    // Update the directory entry on the disk, where it was found when the file was opened
+    if (streamer_seek(fs_private->directory_stream, descriptor->entry_pos) != OK) {
         return -EIO;
     }
 
@@ -1132,3 +1413,34 @@ int fat16_close(void *private_data) {
 
     return OK;
 }
+
+/**
+ * @brief Hands the modified sectors of the in-memory FAT to the buffer cache, which the caller syncs.
+ * @param disk Pointer to the disk structure.
+ * @return Status code indicating success or failure.
+ */
+int fat16_sync(struct disk *disk) {
+    if (!disk || !disk->fs_private) {
+        return -EINVARG;
+    }
+
+    return fat16_flush_fat(disk);
+}
+
+/**
+ * @brief Reports the size and free space of a FAT16 filesystem.
+ * @param disk Pointer to the disk structure.
+ * @param stat Output structure for the filesystem status.
+ * @return Status code indicating success or failure.
+ */
+int fat16_statfs(struct disk *disk, struct file_statfs *stat) {
+    if (!disk || !disk->fs_private || !stat) {
+        return -EINVARG;
+    }
+
+    struct fat_private *private = disk->fs_private;
+    stat->cluster_size = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    stat->total_clusters = private->cluster_count - 2;
+    stat->free_clusters = private->free_clusters;
+    return OK;
+}
@@ -1,8 +1,10 @@
 #include "file.h"
 #include "config.h"
+#include "disk/bcache.h"
 #include "disk/disk.h"
 #include "fat/fat16.h"
 #include "kernel.h"
+#include "locks/mutex.h"
 #include "memory/heap/kheap.h"
 #include "memory/memory.h"
 #include "status.h"
@@ -14,6 +16,13 @@ struct filesystem *filesystems[TOYOS_MAX_FILESYSTEMS] = {NULL};
 // Array of file descriptors
 struct file_descriptor *file_descriptors[TOYOS_MAX_FILE_DESCRIPTORS] = {NULL};
 
+// Serializes file operations, which share the descriptor table and on-disk filesystem state. A
+// mutex, so the holder can let other tasks run while it waits for the disk.
+static struct mutex file_lock = MUTEX_INIT;
+
+// Prefix of the drive programs are loaded from
+static char program_drive[] = "0:/";
+
 /**
  * @brief Finds a free slot in the filesystems array.
  *
@@ -147,6 +156,7 @@ struct filesystem *fs_resolve(struct disk *disk) {
 
 int fopen(const char *filename, const char *mode_str) {
     int res = 0;
+    mutex_lock(&file_lock);
     struct path_root *root_path = path_parser_parse(filename, NULL);
     if (!root_path || !root_path->first) {
         // We cannot have just a root path 0:/ 0:/test.txt
@@ -185,6 +195,8 @@ int fopen(const char *filename, const char *mode_str) {
     res = desc->index;
 
 out:
+    mutex_unlock(&file_lock);
+
     // fopen shouldnt return negative values
     if (res < 0) {
         return 0;
@@ -198,12 +210,15 @@ int fread(void *ptr, uint32_t size, uint32_t nmemb, int fd) {
         return -EINVARG;
     }
 
+    mutex_lock(&file_lock);
+    int res = -EINVARG;
     struct file_descriptor *desc = file_get_descriptor(fd);
-    if (!desc) {
-        return -EINVARG;
+    if (desc) {
+        res = desc->fs->read(desc->disk, desc->private_data, size, nmemb, (char *)ptr);
     }
 
-    return desc->fs->read(desc->disk, desc->private_data, size, nmemb, (char *)ptr);
+    mutex_unlock(&file_lock);
+    return res;
 }
 
 int fwrite(void *ptr, uint32_t size, uint32_t nmemb, int fd) {
@@ -211,12 +226,15 @@ int fwrite(void *ptr, uint32_t size, uint32_t nmemb, int fd) {
         return -EINVARG;
     }
 
+    mutex_lock(&file_lock);
+    int res = -EINVARG;
     struct file_descriptor *desc = file_get_descriptor(fd);
-    if (!desc) {
-        return -EINVARG;
+    if (desc) {
+        res = desc->fs->write(desc->disk, desc->private_data, size, nmemb, (char *)ptr);
     }
 
-    return desc->fs->write(desc->disk, desc->private_data, size, nmemb, (char *)ptr);
+    mutex_unlock(&file_lock);
+    return res;
 }
 
 int fseek(int fd, int offset, file_seek_mode whence) {
@@ -224,12 +242,15 @@ int fseek(int fd, int offset, file_seek_mode whence) {
         return -EINVARG;
     }
 
+    mutex_lock(&file_lock);
+    int res = -EINVARG;
     struct file_descriptor *desc = file_get_descriptor(fd);
-    if (!desc) {
-        return -EINVARG;
+    if (desc) {
+        res = desc->fs->seek(desc->private_data, offset, whence);
     }
 
-    return desc->fs->seek(desc->private_data, offset, whence);
+    mutex_unlock(&file_lock);
+    return res;
 }
 
 int fstat(int fd, struct file_stat *stat) {
@@ -237,12 +258,32 @@ int fstat(int fd, struct file_stat *stat) {
         return -EINVARG;
     }
 
+    mutex_lock(&file_lock);
+    int res = -EINVARG;
     struct file_descriptor *desc = file_get_descriptor(fd);
-    if (!desc) {
-        return -EINVARG;
+    if (desc) {
+        res = desc->fs->stat(desc->disk, desc->private_data, stat);
     }
 
-    return desc->fs->stat(desc->disk, desc->private_data, stat);
+    mutex_unlock(&file_lock);
+    return res;
+}
+
+/**
+ * @brief Writes what the file system of a disk caches, then the buffer cache, with the file lock held.
+ *
+ * @param disk The disk to sync.
+ * @return 0 if successful, or a negative error code.
+ */
+static int fs_sync_locked(struct disk *disk) {
+    if (disk->fs && disk->fs->sync) {
+        int res = disk->fs->sync(disk);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return bcache_sync(disk);
 }
 
 int fclose(int fd) {
@@ -250,18 +291,77 @@ int fclose(int fd) {
         return -EINVARG;
     }
 
+    mutex_lock(&file_lock);
+    int res = -EINVARG;
     struct file_descriptor *desc = file_get_descriptor(fd);
     if (!desc) {
-        return -EINVARG;
+        goto out;
     }
 
-    int res = desc->fs->close(desc->private_data);
+    // Whatever was written to the file reaches the disk once it is closed. The descriptor is
+    // released even if that fails, the error is still reported to the caller.
+    int sync_res = fs_sync_locked(desc->disk);
+
+    res = desc->fs->close(desc->private_data);
     if (res < 0) {
-        return res;
+        goto out;
     }
 
     kfree(desc);
     file_descriptors[fd - 1] = NULL;
+    res = sync_res;
+
+out:
+    mutex_unlock(&file_lock);
+    return res;
+}
+
+int fs_sync(struct disk *disk) {
+    mutex_lock(&file_lock);
+    int res = OK;
+    if (disk) {
+        res = fs_sync_locked(disk);
+        goto out;
+    }
+
+    for (int i = 0; i < disk_get_count(); i++) {
+        struct disk *current = disk_get(i);
+        if (!current) {
+            continue;
+        }
+
+        int status = fs_sync_locked(current);
+        if (status < 0 && res == OK) {
+            res = status;
+        }
+    }
+
+out:
+    mutex_unlock(&file_lock);
+    return res;
+}
+
+int fs_statfs(struct disk *disk, struct file_statfs *stat) {
+    if (!disk || !stat) {
+        return -EINVARG;
+    }
+
+    if (!disk->fs || !disk->fs->statfs) {
+        return -EFSNOTUS;
+    }
+
+    mutex_lock(&file_lock);
+    int res = disk->fs->statfs(disk, stat);
+    mutex_unlock(&file_lock);
+    return res;
+}
+
+void fs_set_program_drive(int drive) {
+    if (drive >= 0 && drive <= 9) {
+        program_drive[0] = '0' + drive;
+    }
+}
 
-    return OK;
+const char *fs_get_program_drive(void) {
+    return program_drive;
 }
@@ -55,6 +55,17 @@ struct file_stat {
     uint32_t filesize;     /**< Size of the file in bytes. */
 };
 
+/**
+ * @brief Structure for storing file system status information.
+ *
+ * This structure holds the size of the file system and how much of it is free.
+ */
+struct file_statfs {
+    uint32_t cluster_size;   /**< Size of an allocation unit in bytes. */
+    uint32_t total_clusters; /**< Number of allocation units that can hold file data. */
+    uint32_t free_clusters;  /**< Number of allocation units that are free. */
+};
+
 /* Function pointer types for file system operations */
 typedef void *(*fs_open_fp)(struct disk *disk, struct path_part *path, file_mode mode);
 typedef int (*fs_resolve_fp)(struct disk *disk);
@@ -63,6 +74,8 @@ typedef int (*fs_write_fp)(struct disk *disk, void *private_data, uint32_t size,
 typedef int (*fs_close_fp)(void *private_data);
 typedef int (*fs_seek_fp)(void *private_data, uint32_t offset, file_seek_mode seek_mode);
 typedef int (*fs_stat_fp)(struct disk *disk, void *private_data, struct file_stat *stat);
+typedef int (*fs_sync_fp)(struct disk *disk);
+typedef int (*fs_statfs_fp)(struct disk *disk, struct file_statfs *stat);
 
 /**
  * @brief File system interface structure.
@@ -79,6 +92,8 @@ struct filesystem {
     fs_seek_fp seek;       /**< Function to seek within a file. */
     fs_stat_fp stat;       /**< Function to get file status. */
     fs_close_fp close;     /**< Function to close a file. */
+    fs_sync_fp sync;       /**< Function to write cached file system data to the disk, or NULL. */
+    fs_statfs_fp statfs;   /**< Function to get file system status, or NULL. */
 };
 
 /**
@@ -168,12 +183,34 @@ int fstat(int fd, struct file_stat *stat);
  * @brief Closes an open file.
  *
  * This function closes a file and releases any resources associated with the file descriptor.
+ * Data written to the file that is still cached by the file system or the buffer cache is written
+ * to the disk.
  *
  * @param fd The file descriptor of the file to close.
  * @return 0 if successful, or a negative error code.
  */
 int fclose(int fd);
 
+/**
+ * @brief Writes everything cached for a disk to it.
+ *
+ * Data the file system keeps in memory is flushed first, then the dirty sectors of the buffer
+ * cache are written back.
+ *
+ * @param disk The disk to sync, or NULL for every disk.
+ * @return 0 if successful, or a negative error code.
+ */
+int fs_sync(struct disk *disk);
+
+/**
+ * @brief Retrieves the size and free space of the file system on a disk.
+ *
+ * @param disk The disk.
+ * @param stat A pointer to a file_statfs structure where the status will be stored.
+ * @return 0 if successful, or a negative error code.
+ */
+int fs_statfs(struct disk *disk, struct file_statfs *stat);
+
 /**
  * @brief Inserts a new file system into the system's list of available file systems.
  *
@@ -194,4 +231,18 @@ void fs_insert_filesystem(struct filesystem *filesystem);
  */
 struct filesystem *fs_resolve(struct disk *disk);
 
+/**
+ * @brief Sets the drive programs are loaded from.
+ *
+ * @param drive The drive number, from 0 to 9.
+ */
+void fs_set_program_drive(int drive);
+
+/**
+ * @brief Returns the path prefix of the drive programs are loaded from.
+ *
+ * @return The prefix, such as "0:/".
+ */
+const char *fs_get_program_drive(void);
+
 #endif
@@ -4,9 +4,12 @@ extern int21h_handler           ; External declaration for the handler function
 extern no_interrupt_handler     ; External declaration for a default or placeholder interrupt handler.
 extern sys_handler              ; External declaration for the handler function for interrupt 0x80 (INT 80h).
 extern interrupt_handler        ; External declaration for a generic interrupt handler.
+extern sysenter_handler         ; External declaration for the handler function for SYSENTER system calls.
+extern tss                      ; External declaration for the task state segment holding the kernel stack pointer.
 
 global no_interrupt             ; This is a generic handler for unexpected or unhandled interrupts.
 global int80h                   ; This is a wrapper for the ISR for interrupt 0x80 (INT 80h).
+global sysenter_entry           ; This is the entry point for system calls made with SYSENTER.
 global idt_load                 ; This function loads the Interrupt Descriptor Table (IDT).
 global enable_interrupt         ; This function enables hardware interrupts.
 global disable_interrupt        ; This function disables hardware interrupts.
@@ -80,6 +83,28 @@ int80h:                         ; Handler for interrupt 0x80 (INT 80h) used for
     sti                         ; Re-enable interrupts.
     iretd                       ; Return from the interrupt, restoring the state saved by the CPU on interrupt entry.
 
+; Entry point for system calls made with SYSENTER, which loads CS, EIP and ESP from MSRs instead of
+; reading the IDT, and saves nothing. The user stub pushes EBP, ECX and EDX and points EBP at them,
+; and sysenter_handler completes the interrupt frame from there so the rest of the system call path
+; is shared with int80h.
+sysenter_entry:
+    mov esp, [tss+4]            ; Switch to the current task's kernel stack (tss.esp0).
+    push dword 0x23             ; User stack segment.
+    push ebp                    ; User stack pointer, corrected by sysenter_handler.
+    pushfd                      ; Flags, interrupts are enabled by sysenter_handler.
+    push dword 0x1b             ; User code segment.
+    push dword 0                ; Return address, read from the user stack by sysenter_handler.
+    pushad                      ; Push all general-purpose registers onto the stack.
+    push esp                    ; Push the stack pointer onto the stack to pass the frame to the handler.
+    call sysenter_handler       ; Call the external handler for SYSENTER.
+    add esp, 4                  ; Remove the frame pointer argument.
+    mov [esp+28], eax           ; Replace the saved EAX with the return value.
+    popad                       ; Restore the registers, with the result in EAX.
+    mov edx, [esp]              ; SYSEXIT returns to the address in EDX...
+    mov ecx, [esp+12]           ; ...with the stack pointer in ECX.
+    sti                         ; Takes effect after SYSEXIT, so no interrupt is taken on the kernel stack.
+    sysexit                     ; Return to ring 3.
+
 section .data                   ; This section defines initialized data that will be stored in memory.
 
 tmp_res dd 0                    ; Define a temporary variable to store the return value from the ISR.
@@ -1,12 +1,16 @@
 #include "idt.h"
 #include "config.h"
+#include "cpu/cpu.h"
 #include "drivers/pic/pic8259.h"
 #include "io/io.h"
 #include "kernel.h"
+#include "memory/heap/kheap.h"
 #include "memory/memory.h"
 #include "status.h"
+#include "sys/ring/ring.h"
 #include "task/process.h"
 #include "task/task.h"
+#include "task/vvar.h"
 
 // Interrupt descriptor table (IDT) descriptors
 struct idt_desc idt_descriptors[TOYOS_TOTAL_INTERRUPTS];
@@ -15,10 +19,17 @@ struct idtr_desc idtr_descriptor;
 // Interrupt callback table
 static interrupt_cb_fp interrupt_callbacks[TOYOS_TOTAL_INTERRUPTS];
 
+// Handlers of hardware interrupt lines shared by several PCI devices, indexed by IRQ
+static interrupt_cb_fp shared_irq_callbacks[16][TOYOS_MAX_SHARED_IRQ_HANDLERS];
+static int shared_irq_count[16];
+
 // Interrupt pointer table
 extern void *interrupt_pointer_table[TOYOS_TOTAL_INTERRUPTS];
 
 extern void int80h(void);
+
+void idt_handle_exception(void);
+extern void sysenter_entry(void);
 extern void int21h(void);
 extern void no_interrupt(void);
 extern void idt_load(struct idtr_desc *ptr);
@@ -26,11 +37,79 @@ extern void idt_load(struct idtr_desc *ptr);
 // System call handler function pointer
 static sys_cmd_fp sys_commands[TOYOS_MAX_SYSCALLS];
 
+// Interrupt latency measurements
+static struct irq_latency_stats latency_stats;
+
+// Call counts and latencies of each system call, across all processes
+static struct syscall_stats syscall_stats[TOYOS_SYSCALL_STATS_MAX];
+
+// TSC value at the previous timer tick
+static uint64_t last_tick = 0;
+
+// Placeholder stack loaded by SYSENTER, used until the entry point switches to tss.esp0
+static uint8_t sysenter_stack[64] __attribute__((aligned(16)));
+
+/**
+ * @brief Checks whether an interrupt was taken while the CPU was running user code
+ *
+ * @param frame The interrupt frame.
+ * @return true if the interrupted code was running in ring 3.
+ */
+static bool interrupt_from_user(struct interrupt_frame *frame) {
+    return (frame->cs & 0x03) == 0x03;
+}
+
+/**
+ * @brief Adds one call to system call statistics
+ *
+ * @param stats The statistics of the system call.
+ * @param cycles The duration of the call, in TSC cycles.
+ */
+static void sys_stats_add(struct syscall_stats *stats, uint64_t cycles) {
+    int bucket = TOYOS_SYSCALL_HISTOGRAM_BUCKETS - 1;
+    uint32_t scaled = (uint32_t)(cycles >> TOYOS_SYSCALL_HISTOGRAM_SHIFT);
+    if (!(cycles >> 32) && scaled < (1u << (TOYOS_SYSCALL_HISTOGRAM_BUCKETS - 1))) {
+        bucket = scaled ? 31 - __builtin_clz(scaled) : 0;
+    }
+
+    stats->calls++;
+    stats->total_cycles += cycles;
+    stats->histogram[bucket]++;
+}
+
+/**
+ * @brief Records a completed system call, globally and for the calling process
+ *
+ * @param cmd The system call number.
+ * @param cycles The duration of the call, in TSC cycles.
+ */
+static void sys_record_command(int cmd, uint64_t cycles) {
+    if (cmd >= TOYOS_SYSCALL_STATS_MAX) {
+        return;
+    }
+
+    // System calls are preemptible, so other tasks update the totals concurrently
+    uint32_t flags = cpu_irq_save();
+    sys_stats_add(&syscall_stats[cmd], cycles);
+    cpu_irq_restore(flags);
+
+    // Only the process's own task updates its statistics
+    struct process *process = task_current()->process;
+    if (process && !process->syscall_stats) {
+        process->syscall_stats = kzalloc(sizeof(struct syscall_stats) * TOYOS_SYSCALL_STATS_MAX);
+    }
+
+    if (process && process->syscall_stats) {
+        sys_stats_add(&process->syscall_stats[cmd], cycles);
+    }
+}
+
 /**
  * @brief Handles system call interrupt
  *
  * This function is called when a system call interrupt occurs. It reads the system call
- * number from the interrupt frame and calls the appropriate system call handler function.
+ * number from the interrupt frame and calls the appropriate system call handler function,
+ * and records how long it took.
  *
  * @param cmd The system call number.
  * @param frame The interrupt frame containing the system call number.
@@ -48,7 +127,26 @@ static void *sys_handle_command(int cmd, struct interrupt_frame *frame) {
         return NULL;
     }
 
-    return handler(frame);
+    uint64_t entered = cpu_read_tsc();
+    void *res = handler(frame);
+    sys_record_command(cmd, cpu_read_tsc() - entered);
+    return res;
+}
+
+void idt_get_syscall_stats(struct syscall_stats *stats, struct process *process) {
+    if (!process) {
+        uint32_t flags = cpu_irq_save();
+        memcpy(stats, syscall_stats, sizeof(syscall_stats));
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    if (!process->syscall_stats) {
+        memset(stats, 0, sizeof(syscall_stats));
+        return;
+    }
+
+    memcpy(stats, process->syscall_stats, sizeof(syscall_stats));
 }
 
 void register_sys_command(int cmd, sys_cmd_fp handler) {
@@ -63,32 +161,121 @@ void register_sys_command(int cmd, sys_cmd_fp handler) {
     sys_commands[cmd] = handler;
 }
 
+void *sys_get_argument(struct interrupt_frame *frame, int index) {
+    if (index < 0 || index >= TOYOS_SYSCALL_MAX_ARGUMENTS) {
+        alertk("Invalid system call argument index: %i\n", index);
+        return NULL;
+    }
+
+    // Compatibility with binaries built before the register ABI: the arguments are on the stack
+    if (!(frame->eax & TOYOS_SYSCALL_REGISTER_ABI)) {
+        return task_get_stack_item(task_current(), index);
+    }
+
+    switch (index) {
+    case 0:
+        return (void *)frame->ebx;
+    case 1:
+        return (void *)frame->ecx;
+    case 2:
+        return (void *)frame->edx;
+    case 3:
+        return (void *)frame->esi;
+    default:
+        return (void *)frame->edi;
+    }
+}
+
 /**
  * @brief Handles system call interrupt
  *
  * This function is called when a system call interrupt occurs. It reads the system call
  * number from the interrupt frame and calls the appropriate system call handler function.
  *
- * @param cmd The system call number.
+ * @param cmd The system call number, possibly flagged with TOYOS_SYSCALL_REGISTER_ABI.
  * @param frame The interrupt frame containing the system call number.
  * @return The result of the system call.
  * @see sys_handle_command
  */
 void *sys_handler(int cmd, struct interrupt_frame *frame) {
+    // The ABI flag stays in frame->eax for sys_get_argument()
+    cmd &= ~TOYOS_SYSCALL_REGISTER_ABI;
+
     // Switch to the kernel page to access the kernel heap
     kernel_page();
 
     // Save the current task state
     task_current_save_state(frame);
+    task_current()->stats.syscalls++;
 
-    // Handle the system call
+    // Handle the system call with interrupts enabled, so device interrupts are serviced and the
+    // timer can preempt the kernel outside of sections that disable preemption
+    uint64_t entered = cpu_read_tsc();
+    enable_interrupt();
     void *res = sys_handle_command(cmd, frame);
+    disable_interrupt();
+
+    uint64_t cycles = cpu_read_tsc() - entered;
+    if (cycles > latency_stats.max_syscall_cycles) {
+        latency_stats.max_syscall_cycles = cycles;
+        latency_stats.max_syscall = cmd;
+    }
+
+    // Killed during the system call: its requests are done and its locks released by now
+    if (task_current()->kill_pending) {
+        process_terminate(task_current()->process);
+        task_next();
+    }
 
     // Switch back to the task page to return to the task
     task_page();
     return res;
 }
 
+/**
+ * @brief Handles a system call made with SYSENTER
+ *
+ * SYSENTER does not save the user return address or stack pointer. The user stub pushes EBP, ECX
+ * and EDX, points EBP at them and is called from the system call wrapper, so the frame is
+ * completed from the user stack and the call returns straight to the wrapper. This runs before
+ * the switch to the kernel page, so the user stack is still mapped.
+ *
+ * @param frame The interrupt frame built by sysenter_entry.
+ * @return The result of the system call.
+ * @see sys_handler
+ */
+void *sysenter_handler(struct interrupt_frame *frame) {
+    uint32_t user_sp = frame->ebp;
+    if (user_sp < TOYOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END ||
+        user_sp > TOYOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - 4 * sizeof(uint32_t)) {
+        // A bad stack pointer cannot be returned to, so the process is terminated like on a fault
+        kernel_page();
+        process_terminate(task_current()->process);
+        task_next();
+    }
+
+    uint32_t *user_stack = (uint32_t *)user_sp;
+    frame->edx = user_stack[0];
+    frame->ecx = user_stack[1];
+    frame->ebp = user_stack[2];
+    frame->ip = user_stack[3];
+    frame->esp = user_sp + 4 * sizeof(uint32_t);
+    frame->flags |= CPU_EFLAGS_IF;
+
+    return sys_handler(frame->eax, frame);
+}
+
+void idt_sysenter_init(void) {
+    if (!(cpu_cpuid_edx(1) & CPU_FEATURE_SEP)) {
+        alertk("SYSENTER not supported, system calls use int 0x80\n");
+        return;
+    }
+
+    cpu_write_msr(CPU_MSR_SYSENTER_CS, TOYOS_CODE_SELECTOR);
+    cpu_write_msr(CPU_MSR_SYSENTER_ESP, (uint32_t)(sysenter_stack + sizeof(sysenter_stack)));
+    cpu_write_msr(CPU_MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+}
+
 /**
  * @brief Handles an interrupt
  *
@@ -99,20 +286,46 @@ void *sys_handler(int cmd, struct interrupt_frame *frame) {
  * @param frame The interrupt frame containing the interrupt number.
  */
 void interrupt_handler(int interrupt, struct interrupt_frame *frame) {
-    // Switch to the kernel page to access the kernel heap
-    kernel_page();
+    // An interrupt taken during a system call keeps the paging of the interrupted kernel code,
+    // and must not overwrite the user state saved when the system call was entered
+    bool from_user = interrupt_from_user(frame);
+    if (from_user) {
+        // Switch to the kernel page to access the kernel heap
+        kernel_page();
+    }
 
-    // Call the interrupt callback if registered
+    // Call the interrupt callback if registered, exceptions nobody handles terminate the task
     interrupt_cb_fp handler = interrupt_callbacks[interrupt];
-    if (handler != NULL) {
-        task_current_save_state(frame);
-        handler(frame);
+    if (!handler && interrupt < 0x20) {
+        handler = idt_handle_exception;
     }
 
-    // Switch back to the task page to return to the task
-    task_page();
+    int shared = interrupt >= 0x20 && interrupt < 0x30 ? shared_irq_count[interrupt - 0x20] : 0;
+    if (handler != NULL || shared > 0) {
+        if (from_user) {
+            task_current_save_state(frame);
+        }
+
+        if (handler != NULL) {
+            handler(frame);
+        }
+
+        // Every device on the line checks whether it raised the interrupt
+        for (int i = 0; i < shared; i++) {
+            shared_irq_callbacks[interrupt - 0x20][i](frame);
+        }
+    }
 
-    pic_send_eoi(interrupt - 0x20);
+    if (from_user) {
+        // Switch back to the task page to return to the task
+        task_page();
+    }
+
+    // Only hardware interrupts are acknowledged, exceptions never reach the PIC. The clock
+    // acknowledges its own interrupt since it usually switches tasks instead of returning.
+    if (interrupt > 0x20 && interrupt < 0x30) {
+        pic_send_eoi(interrupt - 0x20);
+    }
 }
 
 /**
@@ -154,10 +367,47 @@ int idt_register_interrupt_callback(int interrupt, interrupt_cb_fp interrupt_cal
         return -EINVARG;
     }
 
+    bool shared = interrupt >= 0x20 && interrupt < 0x30 && shared_irq_count[interrupt - 0x20] > 0;
+    if (interrupt_callbacks[interrupt] || shared) {
+        return -EBUSY;
+    }
+
     interrupt_callbacks[interrupt] = interrupt_callback;
     return OK;
 }
 
+int idt_register_shared_irq_callback(int irq, interrupt_cb_fp interrupt_callback) {
+    if (irq < 0 || irq >= 16 || !interrupt_callback) {
+        return -EINVARG;
+    }
+
+    if (interrupt_callbacks[0x20 + irq]) {
+        return -EBUSY;
+    }
+
+    int res = OK;
+    uint32_t flags = cpu_irq_save();
+    int count = shared_irq_count[irq];
+    for (int i = 0; i < count; i++) {
+        // Drivers with several devices register the same handler for each of them
+        if (shared_irq_callbacks[irq][i] == interrupt_callback) {
+            goto out;
+        }
+    }
+
+    if (count >= TOYOS_MAX_SHARED_IRQ_HANDLERS) {
+        res = -EBUSY;
+        goto out;
+    }
+
+    shared_irq_callbacks[irq][count] = interrupt_callback;
+    shared_irq_count[irq] = count + 1;
+
+out:
+    cpu_irq_restore(flags);
+    return res;
+}
+
 /**
  * @brief Handles the exception
  */
@@ -166,14 +416,52 @@ void idt_handle_exception(void) {
     task_next();
 }
 
+/**
+ * @brief Records the interval since the previous timer tick
+ */
+static void idt_clock_measure(void) {
+    uint64_t now = cpu_read_tsc();
+    if (last_tick) {
+        uint64_t interval = now - last_tick;
+        if (!latency_stats.min_tick_cycles || interval < latency_stats.min_tick_cycles) {
+            latency_stats.min_tick_cycles = interval;
+        }
+
+        if (interval > latency_stats.max_tick_cycles) {
+            latency_stats.max_tick_cycles = interval;
+        }
+
+        latency_stats.ticks++;
+    }
+
+    last_tick = now;
+}
+
 /**
  * @brief Handles the clock interrupt for task switching
+ *
+ * @param frame The interrupt frame.
  */
-void idt_clock(void) {
+void idt_clock(struct interrupt_frame *frame) {
     pic_send_eoi(0);
+    idt_clock_measure();
+    vvar_tick();
+
+    if (!interrupt_from_user(frame)) {
+        // A system call was interrupted, switch tasks while keeping its kernel context
+        task_preempt();
+        return;
+    }
+
+    // User mode was interrupted, so no kernel locks are held and polled rings can be serviced
+    sys_ring_poll(task_current()->process);
     task_next();
 }
 
+void idt_get_latency_stats(struct irq_latency_stats *stats) {
+    *stats = latency_stats;
+}
+
 void idt_init(void) {
     memset(idt_descriptors, 0, sizeof(idt_descriptors));
     idtr_descriptor.limit = sizeof(idt_descriptors) - 1;
@@ -190,11 +478,6 @@ void idt_init(void) {
     // int 0x80: system call interrupt handler
     idt_set(0x80, int80h);
 
-    // Set all exceptions to the default exception handler
-    for (int i = 0; i < 0x20; i++) {
-        idt_register_interrupt_callback(i, idt_handle_exception);
-    }
-
     // Set the clock interrupt handler
     idt_register_interrupt_callback(0x20, idt_clock);
 
@@ -1,10 +1,12 @@
 #ifndef _IDT_H_
 #define _IDT_H_
 
+#include "config.h"
 #include <stdint.h>
 
-// Forward declaration of the interrupt frame structure
+// Forward declarations
 struct interrupt_frame;
+struct process;
 
 // Function pointer type for interrupt service routines (ISRs)
 typedef void *(*sys_cmd_fp)(struct interrupt_frame *frame);
@@ -63,6 +65,56 @@ struct interrupt_frame {
     uint32_t ss;
 } __attribute__((packed));
 
+/**
+ * @brief Interrupt latency measurements
+ *
+ * The timer fires at a fixed rate, so the spread between the shortest and longest interval
+ * between two ticks is the worst delay seen before the timer interrupt was serviced.
+ */
+struct irq_latency_stats {
+    uint64_t min_tick_cycles;    /**< Shortest interval between two timer ticks, in TSC cycles. */
+    uint64_t max_tick_cycles;    /**< Longest interval between two timer ticks, in TSC cycles. */
+    uint64_t max_syscall_cycles; /**< Longest system call, which is how long interrupts were masked before syscalls became preemptible. */
+    uint32_t max_syscall;        /**< The system call number of the longest system call. */
+    uint32_t ticks;              /**< Number of timer ticks measured. */
+};
+
+/**
+ * @brief Call counts and latencies of one system call
+ *
+ * Bucket i of the histogram counts calls that took from 2^(i + TOYOS_SYSCALL_HISTOGRAM_SHIFT) to
+ * 2^(i + TOYOS_SYSCALL_HISTOGRAM_SHIFT + 1) cycles, with faster calls in the first bucket and
+ * slower ones in the last. Latencies include time spent blocked or preempted in the call.
+ */
+struct syscall_stats {
+    uint64_t total_cycles;                               /**< Total TSC cycles spent in the system call. */
+    uint32_t calls;                                      /**< Number of calls. */
+    uint32_t histogram[TOYOS_SYSCALL_HISTOGRAM_BUCKETS]; /**< Number of calls per latency bucket. */
+};
+
+/**
+ * @brief Copies the system call statistics
+ *
+ * @param stats Array of TOYOS_SYSCALL_STATS_MAX entries to fill, indexed by system call number.
+ * @param process The process to report, or NULL for the totals of all processes.
+ */
+void idt_get_syscall_stats(struct syscall_stats *stats, struct process *process);
+
+/**
+ * @brief Copies the interrupt latency measurements
+ *
+ * @param stats The structure to fill.
+ */
+void idt_get_latency_stats(struct irq_latency_stats *stats);
+
+/**
+ * @brief Enables the SYSENTER system call entry point
+ *
+ * Programs the SYSENTER MSRs so user code can enter the kernel without an IDT gate transition.
+ * Call this after the TSS is set up. If the CPU lacks SYSENTER, system calls keep using int 0x80.
+ */
+void idt_sysenter_init(void);
+
 /**
  * @brief Registers a system call handler function
  *
@@ -76,17 +128,43 @@ struct interrupt_frame {
  */
 void register_sys_command(int cmd, sys_cmd_fp handler);
 
+/**
+ * @brief Gets a system call argument
+ *
+ * Callers that set TOYOS_SYSCALL_REGISTER_ABI in EAX pass up to five arguments in EBX, ECX,
+ * EDX, ESI and EDI, which are read straight from the interrupt frame. Older binaries push the
+ * arguments on their stack instead, and those are still read from the calling task's stack.
+ *
+ * @param frame The interrupt frame of the system call.
+ * @param index The index of the argument, starting at 0.
+ * @return The argument value.
+ */
+void *sys_get_argument(struct interrupt_frame *frame, int index);
+
 /**
  * @brief Registers an interrupt callback function
  *
- * This function registers an interrupt callback function for the given interrupt number.
+ * This function registers an interrupt callback function for the given interrupt number. The
+ * callback is the only handler of the interrupt. Exceptions without a callback terminate the task.
  *
  * @param interrupt The interrupt number.
  * @param interrupt_cb The interrupt callback function.
- * @return 0 on success, error code on failure.
+ * @return 0 on success, -EBUSY if the interrupt already has a handler, error code on failure.
  */
 int idt_register_interrupt_callback(int interrupt, interrupt_cb_fp interrupt_cb);
 
+/**
+ * @brief Registers a handler for a hardware interrupt line shared by several devices
+ *
+ * PCI devices may share a line, so every handler registered for it is called on each interrupt
+ * and must check whether its device raised it. Registering the same handler again has no effect.
+ *
+ * @param irq The IRQ line, 0 to 15.
+ * @param interrupt_cb The interrupt callback function.
+ * @return 0 on success, -EBUSY if the line has an exclusive handler or no free slot, error code on failure.
+ */
+int idt_register_shared_irq_callback(int irq, interrupt_cb_fp interrupt_cb);
+
 /**
  * @brief Initializes the interrupt descriptor table (IDT) with default handlers
  */
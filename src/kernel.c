@@ -1,6 +1,9 @@
 #include "kernel.h"
 #include "config.h"
+#include "cpu/fpu.h"
+#include "disk/bcache.h"
 #include "disk/disk.h"
+#include "disk/ramdisk.h"
 #include "disk/streamer.h"
 #include "drivers/keyboards/ps2.h"
 #include "drivers/pci/pci.h"
@@ -60,13 +63,8 @@ static void print_toyos_logo(void) {
 }
 
 void printk_colored(const char *str, unsigned char fg, unsigned char bg) {
-    size_t len = strlen(str);
-
-    for (int i = 0; i < len; i++) {
-        terminal_writechar(str[i], fg, bg);
-    }
-
-    terminal_update_cursor();
+    terminal_write(str, strlen(str), fg, bg);
+    terminal_flush();
 }
 
 void printk(const char *str) {
@@ -109,20 +107,28 @@ void maink(void) {
     // Initialize the heap, file system, disk, and IDT
     printk_colored("Initializing the heap...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
     kheap_init();
+    bcache_init();
     printk_colored("Initializing the file system...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
     fs_init();
     disk_search_and_init();
     printk_colored("Initializing the IDT...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
     idt_init();
 
+    // Enable the FPU and SSE with lazy per-task context switching
+    printk_colored("Enabling the FPU...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
+    fpu_init();
+
     // Setup the task state segment (TSS)
     printk_colored("Setting up the TSS...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
     memset(&tss, 0, sizeof(tss));
-    tss.esp0 = 0x60000;             // Set the stack pointer for ring 0
+    tss.esp0 = 0x60000;             // Set the stack pointer for ring 0 (replaced by each task's own kernel stack)
     tss.ss0 = TOYOS_DATA_SELECTOR;  // Set the stack segment for ring 0
 
     tss_load(0x28);
 
+    // Enable the SYSENTER fast system call path, which takes its stack from the TSS
+    idt_sysenter_init();
+
     // Set up paging for the kernel
     printk_colored("Setting up paging...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
     kernel_chunk = paging_new_4gb(PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
@@ -152,12 +158,25 @@ void maink(void) {
         printf("No network interfaces were brought up\n");
     }
 
+    // Copy the boot disk into memory once DMA is set up, so programs load without touching the disk
+    printk_colored("Loading the RAM disk...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
+    int ramdisk = ramdisk_load(disk_get(0), TOYOS_RAMDISK_MAX_SECTORS);
+    if (ramdisk >= 0 && disk_get(ramdisk)->fs) {
+        fs_set_program_drive(ramdisk);
+    } else {
+        printf("No RAM disk, programs are loaded from disk 0\n");
+    }
+
     print_toyos_logo();
 
     // Load the first process
     printk_colored("Loading the shell...\n", VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLUE);
+    char shell_path[TOYOS_MAX_PATH];
+    strcpy(shell_path, fs_get_program_drive());
+    strcat(shell_path, "shell.elf");
+
     struct process *process = NULL;
-    int res = process_load_and_switch("0:/shell.elf", &process);
+    int res = process_load_and_switch(shell_path, &process);
     if (ISERROR(res)) {
         panick("Failed to load the shell!\n");
     }
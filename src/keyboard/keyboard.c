@@ -1,5 +1,6 @@
 #include "keyboard.h"
 #include "kernel.h"
+#include "memory/heap/kheap.h"
 #include "status.h"
 #include "task/process.h"
 #include "task/task.h"
@@ -46,25 +47,25 @@ out:
  * @return The tail index.
  */
 static int keyboard_get_tail_index(struct process *process) {
-    if (!process) {
+    if (!process || !process->keyboard) {
         return -EINVARG;
     }
 
-    return process->keyboard.tail % sizeof(process->keyboard.buffer);
+    return process->keyboard->tail % sizeof(process->keyboard->buffer);
 }
 
 void keyboard_backspace(struct process *process) {
-    if (!process) {
+    if (!process || !process->keyboard) {
         return;
     }
 
-    process->keyboard.tail -= 1;
+    process->keyboard->tail -= 1;
     int real_index = keyboard_get_tail_index(process);
     if (real_index < 0) {
         return;
     }
 
-    process->keyboard.buffer[real_index] = 0x00;
+    process->keyboard->buffer[real_index] = 0x00;
 }
 
 void keyboard_push(char c) {
@@ -73,9 +74,17 @@ void keyboard_push(char c) {
         return;
     }
 
+    // The buffer is only allocated once the process receives its first key
+    if (!process->keyboard) {
+        process->keyboard = kzalloc(sizeof(struct keyboard_buffer));
+        if (!process->keyboard) {
+            return;
+        }
+    }
+
     int real_index = keyboard_get_tail_index(process);
-    process->keyboard.buffer[real_index] = c;
-    process->keyboard.tail++;
+    process->keyboard->buffer[real_index] = c;
+    process->keyboard->tail++;
 }
 
 char keyboard_pop(void) {
@@ -84,15 +93,19 @@ char keyboard_pop(void) {
     }
 
     struct process *process = task_current()->process;
-    int real_index = process->keyboard.head % sizeof(process->keyboard.buffer);
-    char c = process->keyboard.buffer[real_index];
+    if (!process->keyboard) {
+        return 0;
+    }
+
+    int real_index = process->keyboard->head % sizeof(process->keyboard->buffer);
+    char c = process->keyboard->buffer[real_index];
     if (c == 0x00) {
         // Nothing to pop return zero.
         return 0;
     }
 
-    process->keyboard.buffer[real_index] = 0;
-    process->keyboard.head += 1;
+    process->keyboard->buffer[real_index] = 0;
+    process->keyboard->head += 1;
     return c;
 }
 
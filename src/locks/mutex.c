@@ -0,0 +1,20 @@
+#include "mutex.h"
+#include "task/task.h"
+
+void mutex_lock(struct mutex *mutex) {
+    while (__sync_lock_test_and_set(&mutex->locked, 1)) {
+        // Let the holder run so it can release the mutex
+        task_yield();
+    }
+
+    mutex->owner = task_current();
+}
+
+void mutex_unlock(struct mutex *mutex) {
+    mutex->owner = NULL;
+    __sync_lock_release(&mutex->locked);
+}
+
+bool mutex_is_locked(struct mutex *mutex) {
+    return mutex->locked != 0;
+}
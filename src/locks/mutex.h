@@ -0,0 +1,54 @@
+#ifndef _MUTEX_H_
+#define _MUTEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declaration of task
+struct task;
+
+/**
+ * @brief Static initializer for a mutex.
+ */
+#define MUTEX_INIT {.locked = 0, .owner = 0}
+
+/**
+ * @brief Mutex structure
+ *
+ * Unlike a spinlock, a mutex can be held while the holder gives up the CPU, for example while it
+ * waits for a disk transfer. A task that finds the mutex taken switches to other tasks until it
+ * is released, instead of spinning with preemption disabled.
+ *
+ * @var locked Non-zero while the mutex is held.
+ * @var owner The task holding the mutex, or NULL.
+ */
+struct mutex {
+    volatile uint32_t locked;
+    struct task *owner;
+};
+
+/**
+ * @brief Locks the mutex
+ *
+ * Must not be called with a spinlock held, since the caller may be switched out.
+ *
+ * @param mutex The mutex to lock.
+ */
+void mutex_lock(struct mutex *mutex);
+
+/**
+ * @brief Unlocks the mutex
+ *
+ * @param mutex The mutex to unlock.
+ */
+void mutex_unlock(struct mutex *mutex);
+
+/**
+ * @brief Checks whether the mutex is held
+ *
+ * @param mutex The mutex to check.
+ * @return true if the mutex is held, false otherwise.
+ */
+bool mutex_is_locked(struct mutex *mutex);
+
+#endif
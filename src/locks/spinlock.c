@@ -1,10 +1,116 @@
 #include "spinlock.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "memory/memory.h"
+#include "stdlib/string.h"
+#include "task/task.h"
+
+// Registry of locks whose statistics can be reported
+static struct spinlock_t *spinlocks[TOYOS_MAX_SPINLOCKS];
+static int spinlock_count = 0;
+
+/**
+ * @brief Adds a lock to the registry
+ *
+ * Locks beyond TOYOS_MAX_SPINLOCKS still work, their statistics are just not reported.
+ *
+ * @param lock The spinlock to register.
+ */
+static void spin_lock_register(struct spinlock_t *lock) {
+    uint32_t flags = cpu_irq_save();
+    if (!lock->registered && spinlock_count < TOYOS_MAX_SPINLOCKS) {
+        spinlocks[spinlock_count++] = lock;
+        lock->registered = true;
+    }
+
+    cpu_irq_restore(flags);
+}
+
+void spin_lock_init(struct spinlock_t *lock, const char *name) {
+    memset(lock, 0, sizeof(struct spinlock_t));
+    lock->name = name;
+    spin_lock_register(lock);
+}
 
 void spin_lock(struct spinlock_t *lock) {
-    while (__sync_lock_test_and_set(&lock->locked, 1))
-        ;
+    if (!lock->registered) {
+        spin_lock_register(lock);
+    }
+
+    // The holder must not be switched out, or a waiter could spin forever
+    preempt_disable();
+
+    uint32_t ticket = __sync_fetch_and_add(&lock->next, 1);
+    uint32_t spins = 0;
+    while (lock->owner != ticket) {
+        spins++;
+        asm volatile("pause");
+    }
+
+    // The lock is held from here on, so the statistics need no further protection
+    lock->acquired_at = cpu_read_tsc();
+    lock->stats.acquisitions++;
+    if (spins) {
+        lock->stats.contended++;
+        lock->stats.spins += spins;
+    }
+}
+
+/**
+ * @brief Releases the lock without re-enabling preemption
+ *
+ * @param lock The spinlock to release.
+ * @return true if the lock was held, false otherwise.
+ */
+static bool spin_release(struct spinlock_t *lock) {
+    if (!spin_is_locked(lock)) {
+        return false;
+    }
+
+    uint64_t held = cpu_read_tsc() - lock->acquired_at;
+    if (held > lock->stats.max_hold_cycles) {
+        lock->stats.max_hold_cycles = held;
+    }
+
+    __sync_synchronize();
+    lock->owner++;
+    return true;
 }
 
 void spin_unlock(struct spinlock_t *lock) {
-    __sync_lock_release(&lock->locked);
-}
\ No newline at end of file
+    if (spin_release(lock)) {
+        preempt_enable();
+    }
+}
+
+uint32_t spin_lock_irqsave(struct spinlock_t *lock) {
+    uint32_t flags = cpu_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+void spin_unlock_irqrestore(struct spinlock_t *lock, uint32_t flags) {
+    bool released = spin_release(lock);
+    cpu_irq_restore(flags);
+
+    // Only now can a deferred task switch happen, once interrupts are enabled again
+    if (released) {
+        preempt_enable();
+    }
+}
+
+bool spin_is_locked(struct spinlock_t *lock) {
+    return lock->owner != lock->next;
+}
+
+int spin_lock_get_stats(struct spinlock_info *info, int max) {
+    int count = 0;
+    for (int i = 0; i < spinlock_count && count < max; i++) {
+        struct spinlock_t *lock = spinlocks[i];
+        strncpy(info[count].name, lock->name ? lock->name : "?", sizeof(info[count].name));
+        info[count].stats = lock->stats;
+        count++;
+    }
+
+    return count;
+}
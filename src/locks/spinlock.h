@@ -1,19 +1,84 @@
 #ifndef _SPINLOCK_H_
 #define _SPINLOCK_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/**
+ * @brief Maximum length of a spinlock name, including the null terminator.
+ */
+#define SPINLOCK_NAME_MAX 16
+
+/**
+ * @brief Static initializer for a named spinlock.
+ *
+ * Locks defined with this initializer are added to the lock registry the first time
+ * they are acquired, so their statistics can be read through the lock stats system call.
+ *
+ * @param lock_name The name reported in the lock statistics.
+ */
+#define SPINLOCK_INIT(lock_name) {.next = 0, .owner = 0, .name = (lock_name)}
+
+/**
+ * @brief Contention statistics for a spinlock
+ *
+ * @var acquisitions Number of times the lock was acquired.
+ * @var contended Number of acquisitions that had to wait for another holder.
+ * @var spins Total number of wait loop iterations across all contended acquisitions.
+ * @var max_hold_cycles Longest time the lock was held, in TSC cycles.
+ */
+struct spinlock_stats {
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint32_t spins;
+    uint64_t max_hold_cycles;
+};
+
 /**
  * @brief Spinlock structure
  *
- * This structure represents a spinlock.
+ * This structure represents a fair ticket spinlock. Each caller takes the next ticket and
+ * waits until the owner counter reaches it, so waiters are served in arrival order. Kernel
+ * preemption is disabled while the lock is held.
  *
- * @var locked The lock status.
+ * @var next The next ticket to hand out.
+ * @var owner The ticket currently holding the lock.
+ * @var name The name reported in the lock statistics.
+ * @var registered Whether the lock has been added to the lock registry.
+ * @var acquired_at TSC value at the time the lock was last acquired.
+ * @var stats The contention statistics for the lock.
  */
 struct spinlock_t {
-    volatile uint32_t locked;
+    volatile uint32_t next;
+    volatile uint32_t owner;
+    const char *name;
+    bool registered;
+    uint64_t acquired_at;
+    struct spinlock_stats stats;
+};
+
+/**
+ * @brief Spinlock statistics as reported to user space
+ *
+ * @var name The name of the lock (empty if the slot is unused).
+ * @var stats The contention statistics for the lock.
+ */
+struct spinlock_info {
+    char name[SPINLOCK_NAME_MAX];
+    struct spinlock_stats stats;
 };
 
+/**
+ * @brief Initializes a spinlock
+ *
+ * This function initializes a spinlock at runtime and registers it for statistics. Use it
+ * for locks embedded in dynamically allocated structures.
+ *
+ * @param lock The spinlock to initialize.
+ * @param name The name reported in the lock statistics.
+ */
+void spin_lock_init(struct spinlock_t *lock, const char *name);
+
 /**
  * @brief Locks the spinlock
  *
@@ -26,10 +91,46 @@ void spin_lock(struct spinlock_t *lock);
 /**
  * @brief Unlocks the spinlock
  *
- * This function unlocks the spinlock.
+ * This function unlocks the spinlock. Unlocking a lock that is not held has no effect.
  *
  * @param lock The spinlock to unlock.
  */
 void spin_unlock(struct spinlock_t *lock);
 
+/**
+ * @brief Disables interrupts and locks the spinlock
+ *
+ * Use this variant for locks that are also taken from interrupt handlers, so the holder
+ * cannot be interrupted by a handler that spins on the same lock.
+ *
+ * @param lock The spinlock to lock.
+ * @return The EFLAGS value to pass to spin_unlock_irqrestore().
+ */
+uint32_t spin_lock_irqsave(struct spinlock_t *lock);
+
+/**
+ * @brief Unlocks the spinlock and restores the interrupt state
+ *
+ * @param lock The spinlock to unlock.
+ * @param flags The value returned by spin_lock_irqsave().
+ */
+void spin_unlock_irqrestore(struct spinlock_t *lock, uint32_t flags);
+
+/**
+ * @brief Checks whether the spinlock is held
+ *
+ * @param lock The spinlock to check.
+ * @return true if the lock is held, false otherwise.
+ */
+bool spin_is_locked(struct spinlock_t *lock);
+
+/**
+ * @brief Copies the statistics of all registered spinlocks
+ *
+ * @param info Array to fill with the lock statistics.
+ * @param max Number of entries in the array.
+ * @return The number of entries filled.
+ */
+int spin_lock_get_stats(struct spinlock_info *info, int max);
+
 #endif
@@ -2,12 +2,16 @@
 #include "config.h"
 #include "heap.h"
 #include "kernel.h"
+#include "locks/spinlock.h"
 #include "memory/memory.h"
 
 // Structure representing the kernel heap and its table
 struct heap kernel_heap;
 struct heap_table kernel_heap_table;
 
+// Protects the kernel heap, which is also used from interrupt handlers
+static struct spinlock_t kheap_lock = SPINLOCK_INIT("kheap");
+
 void kheap_init() {
     // Calculate the total number of blocks in the heap
     int total_table_entries = TOYOS_HEAP_SIZE_BYTES / TOYOS_HEAP_BLOCK_SIZE;
@@ -27,7 +31,10 @@ void kheap_init() {
 }
 
 void *kmalloc(size_t size) {
-    return malloc(&kernel_heap, size);
+    uint32_t flags = spin_lock_irqsave(&kheap_lock);
+    void *ptr = malloc(&kernel_heap, size);
+    spin_unlock_irqrestore(&kheap_lock, flags);
+    return ptr;
 }
 
 void *kzalloc(size_t size) {
@@ -41,5 +48,7 @@ void *kzalloc(size_t size) {
 }
 
 void kfree(void *ptr) {
+    uint32_t flags = spin_lock_irqsave(&kheap_lock);
     free(&kernel_heap, ptr);
+    spin_unlock_irqrestore(&kheap_lock, flags);
 }
@@ -79,5 +79,6 @@
  * This error occurs when a resource is already in use and cannot be accessed.
  */
 #define EBUSY 10 /** < Resource is busy */
+#define EFAULT 11 /** < Bad user address */
 
 #endif
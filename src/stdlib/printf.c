@@ -17,11 +17,7 @@
  * @param bg The background color of the text.
  */
 static void print(const char *str, unsigned char fg, unsigned char bg) {
-    size_t len = strlen(str);
-
-    for (int i = 0; i < len; i++) {
-        terminal_writechar(str[i], fg, bg);
-    }
+    terminal_write(str, strlen(str), fg, bg);
 }
 
 int printf(const char *fmt, ...) {
@@ -33,7 +29,7 @@ int printf(const char *fmt, ...) {
     va_start(ap, fmt);
     for (p = fmt; *p; p++) {
         if (*p != '%') {
-            terminal_writechar(*p, COLOR_WHITE, COLOR_BLUE);
+            terminal_write(p, 1, COLOR_WHITE, COLOR_BLUE);
             continue;
         }
 
@@ -54,14 +50,14 @@ int printf(const char *fmt, ...) {
             break;
 
         default:
-            terminal_writechar(*p, COLOR_WHITE, COLOR_BLUE);
+            terminal_write(p, 1, COLOR_WHITE, COLOR_BLUE);
             break;
         }
     }
 
     va_end(ap);
 
-    terminal_update_cursor();
+    terminal_flush();
 
     return 0;
 }
@@ -75,7 +71,7 @@ int printf_colored(const char *fmt, unsigned char fg, unsigned char bg, ...) {
     va_start(ap, bg);
     for (p = fmt; *p; p++) {
         if (*p != '%') {
-            terminal_writechar(*p, fg, bg);
+            terminal_write(p, 1, fg, bg);
             continue;
         }
 
@@ -91,14 +87,14 @@ int printf_colored(const char *fmt, unsigned char fg, unsigned char bg, ...) {
             break;
 
         default:
-            terminal_writechar(*p, fg, bg);
+            terminal_write(p, 1, fg, bg);
             break;
         }
     }
 
     va_end(ap);
 
-    terminal_update_cursor();
+    terminal_flush();
 
     return 0;
 }
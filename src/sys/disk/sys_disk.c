@@ -0,0 +1,104 @@
+#include "sys_disk.h"
+#include "config.h"
+#include "disk/disk.h"
+#include "fs/file.h"
+#include "idt/idt.h"
+#include "kernel.h"
+#include "memory/heap/kheap.h"
+#include "status.h"
+#include "task/process.h"
+#include "task/task.h"
+
+void *sys_command28_disk_read(struct interrupt_frame *frame) {
+    int index = (int)sys_get_argument(frame, 0);
+    unsigned int lba = (unsigned int)sys_get_argument(frame, 1);
+    int total = (int)sys_get_argument(frame, 2);
+    char *user_buf = sys_get_argument(frame, 3);
+    int flags = (int)sys_get_argument(frame, 4);
+
+    struct disk *disk = disk_get(index);
+    if (!disk || total <= 0) {
+        return ERROR(-EINVARG);
+    }
+
+    // Raw reads bypass the caches, so data still cached must reach the disk first
+    int res = fs_sync(disk);
+    if (res < 0) {
+        return ERROR(res);
+    }
+
+    // The sectors are read into kernel memory, which the DMA engine can address directly
+    int chunk = total < SYS_DISK_CHUNK_SECTORS ? total : SYS_DISK_CHUNK_SECTORS;
+    char *buf = kmalloc(chunk * TOYOS_SECTOR_SIZE);
+    if (!buf) {
+        return ERROR(-ENOMEM);
+    }
+
+    int done = 0;
+    while (done < total) {
+        int count = total - done;
+        if (count > chunk) {
+            count = chunk;
+        }
+
+        if (flags & SYS_DISK_READ_PIO) {
+            res = disk_read_block_pio(disk, lba + done, count, buf);
+        } else {
+            res = disk_read_block(disk, lba + done, count, buf);
+        }
+
+        if (res < 0) {
+            goto out;
+        }
+
+        res = copy_to_user(task_current(), user_buf + done * TOYOS_SECTOR_SIZE, buf, count * TOYOS_SECTOR_SIZE);
+        if (res < 0) {
+            goto out;
+        }
+
+        done += count;
+    }
+
+    res = done;
+
+out:
+    kfree(buf);
+    return ERROR(res);
+}
+
+void *sys_command30_sync(struct interrupt_frame *frame) {
+    int index = (int)sys_get_argument(frame, 0);
+
+    struct disk *disk = NULL;
+    if (index != -1) {
+        disk = disk_get(index);
+        if (!disk) {
+            return ERROR(-EINVARG);
+        }
+    }
+
+    return ERROR(fs_sync(disk));
+}
+
+void *sys_command31_statfs(struct interrupt_frame *frame) {
+    int index = (int)sys_get_argument(frame, 0);
+
+    struct disk *disk = disk_get(index);
+    if (!disk) {
+        return ERROR(-EINVARG);
+    }
+
+    struct file_statfs *stat =
+        (struct file_statfs *)process_malloc(task_current()->process, sizeof(struct file_statfs));
+    if (!stat) {
+        return ERROR(-ENOMEM);
+    }
+
+    int res = fs_statfs(disk, stat);
+    if (res < 0) {
+        process_free(task_current()->process, stat);
+        return ERROR(res);
+    }
+
+    return stat;
+}
@@ -0,0 +1,51 @@
+#ifndef _SYS_DISK_H_
+#define _SYS_DISK_H_
+
+// Forward declaration of interrupt_frame.
+struct interrupt_frame;
+
+/**
+ * @brief Flags for the raw disk read system call.
+ */
+#define SYS_DISK_READ_PIO 0x1 /**< Use programmed I/O even if DMA is available. */
+
+/**
+ * @brief Number of sectors read into the kernel at a time before being copied to the caller.
+ */
+#define SYS_DISK_CHUNK_SECTORS 128
+
+/**
+ * @brief System command handler for reading raw sectors from a disk.
+ *
+ * This function is called when the system command SYSTEM_COMMAND28_DISK_READ is invoked. Its
+ * arguments are the disk index, the first LBA, the number of sectors, the user buffer and the
+ * SYS_DISK_READ_* flags. It is used to measure disk throughput below the file system.
+ *
+ * @param frame The interrupt frame.
+ * @return The number of sectors read, or an error code.
+ */
+void *sys_command28_disk_read(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for writing cached data back to the disk.
+ *
+ * This function is called when the system command SYSTEM_COMMAND30_SYNC is invoked. Its argument
+ * is the index of the disk to sync, or -1 to sync every disk.
+ *
+ * @param frame The interrupt frame.
+ * @return 0 on success, or an error code.
+ */
+void *sys_command30_sync(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for reading the size and free space of a file system.
+ *
+ * This function is called when the system command SYSTEM_COMMAND31_STATFS is invoked. Its argument
+ * is the index of the disk. The result is allocated in the calling process.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to a file_statfs structure, or an error code.
+ */
+void *sys_command31_statfs(struct interrupt_frame *frame);
+
+#endif
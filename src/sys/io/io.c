@@ -1,6 +1,8 @@
 #include "io.h"
+#include "idt/idt.h"
 #include "kernel.h"
 #include "keyboard/keyboard.h"
+#include "status.h"
 #include "task/task.h"
 #include "terminal/terminal.h"
 
@@ -11,7 +13,7 @@ void *sys_command1_print(struct interrupt_frame *frame) {
 
     // Get the message buffer from the user space
     char buf[1024];
-    void *user_space_msg_buffer = task_get_stack_item(task_current(), 0);
+    void *user_space_msg_buffer = sys_get_argument(frame, 0);
     copy_string_from_task(task_current(), user_space_msg_buffer, buf, sizeof(buf));
 
     // Print the message to the console
@@ -34,13 +36,67 @@ void *sys_command3_putchar(struct interrupt_frame *frame) {
     }
 
     // Get the character from the user space and write it to the console
-    char c = (char)(int)task_get_stack_item(task_current(), 0);
+    char c = (char)(int)sys_get_argument(frame, 0);
     terminal_update_cursor();
     terminal_writechar(c, VGA_COLOR_WHITE, VGA_COLOR_BLUE);
 
     return NULL;
 }
 
+void *sys_command27_write(struct interrupt_frame *frame) {
+    if (!frame) {
+        return NULL;
+    }
+
+    int fd = (int)sys_get_argument(frame, 0);
+    const char *user_buf = sys_get_argument(frame, 1);
+    int len = (int)sys_get_argument(frame, 2);
+    if (len < 0) {
+        return ERROR(-EINVARG);
+    }
+
+    // Only the console can be written for now, errors are shown in red
+    unsigned char fg;
+    switch (fd) {
+    case SYS_IO_STDOUT:
+        fg = VGA_COLOR_WHITE;
+        break;
+
+    case SYS_IO_STDERR:
+        fg = VGA_COLOR_LIGHT_RED;
+        break;
+
+    default:
+        return ERROR(-EINVARG);
+    }
+
+    // Copy the buffer in chunks so a large write does not need a large kernel allocation
+    char buf[SYS_IO_WRITE_CHUNK_SIZE];
+    int written = 0;
+    while (written < len) {
+        int chunk = len - written;
+        if (chunk > sizeof(buf)) {
+            chunk = sizeof(buf);
+        }
+
+        int res = copy_from_user(task_current(), buf, user_buf + written, chunk);
+        if (res < 0) {
+            if (written == 0) {
+                return ERROR(res);
+            }
+
+            break;
+        }
+
+        terminal_write(buf, chunk, fg, VGA_COLOR_BLUE);
+        written += chunk;
+    }
+
+    // The screen is drawn once for the whole write
+    terminal_flush();
+    return (void *)written;
+}
+
 void *sys_command10_clear_terminal(struct interrupt_frame *frame) {
     if (!frame) {
         return NULL;
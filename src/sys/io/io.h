@@ -4,6 +4,17 @@
 // Forward declaration of interrupt_frame
 struct interrupt_frame;
 
+/**
+ * @brief File descriptors that refer to the console.
+ */
+#define SYS_IO_STDOUT 1
+#define SYS_IO_STDERR 2
+
+/**
+ * @brief Number of bytes copied from user space at a time by the write system call.
+ */
+#define SYS_IO_WRITE_CHUNK_SIZE 1024
+
 /**
  * @brief Prints a string to the console.
  *
@@ -37,6 +48,19 @@ void *sys_command2_getkey(struct interrupt_frame *frame);
  */
 void *sys_command3_putchar(struct interrupt_frame *frame);
 
+/**
+ * @brief Writes a buffer to a file descriptor.
+ *
+ * This function is a system command that can be invoked using interrupt 0x80. Its arguments are
+ * the file descriptor, the buffer and its length. Only the console descriptors SYS_IO_STDOUT and
+ * SYS_IO_STDERR are supported for now. The buffer is copied from user space and drawn with a
+ * single terminal flush, instead of one system call and one screen update per character.
+ *
+ * @param frame The interrupt frame containing the system call arguments.
+ * @return void* The number of bytes written, or a negative error code.
+ */
+void *sys_command27_write(struct interrupt_frame *frame);
+
 /**
  * @brief Clears the terminal.
  *
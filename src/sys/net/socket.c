@@ -23,6 +23,8 @@
  */
 
 #include "sys/net/socket.h"
+#include "cpu/cpu.h"
+#include "locks/spinlock.h"
 #include "memory/memory.h"
 #include "stdlib/printf.h"
 #include "sys/net/netdev.h"
@@ -31,6 +33,13 @@
 /* The global socket table. Simple flat array indexed by descriptor. */
 static struct socket sockets[MAX_SOCKETS];
 
+/*
+ * Protects the receive queues. Packets are delivered from the NIC
+ * interrupt handler while recvfrom() runs in a system call, so the
+ * lock is always taken with interrupts disabled.
+ */
+static struct spinlock_t socket_lock = SPINLOCK_INIT("socket");
+
 int socket_create(int type) {
     /*
      * Only UDP (SOCK_DGRAM) is supported.
@@ -128,7 +137,13 @@ int socket_sendto(int sockfd, void *buf, int len, uint8_t *dst_ip, uint16_t dst_
     memcpy(payload->data, buf, len);
     payload->len = len;
 
+    /*
+     * The rest of the stack (ARP cache, IP, the NIC) is otherwise only
+     * entered from the receive interrupt, so keep it out while we transmit.
+     */
+    uint32_t flags = cpu_irq_save();
     int res = udp_tx(dev, dst_ip, src_port, dst_port, payload);
+    cpu_irq_restore(flags);
     netbuf_free(payload);
 
     if (res < 0) {
@@ -157,7 +172,9 @@ int socket_recvfrom(int sockfd, void *buf, int max_len, uint8_t *src_ip_out, uin
      * A real OS would put the process to sleep and wake it when
      * a packet arrives (select/poll/epoll in Linux).
      */
+    uint32_t flags = spin_lock_irqsave(&socket_lock);
     if (sockets[sockfd].recv_count == 0) {
+        spin_unlock_irqrestore(&socket_lock, flags);
         return 0; /* No data available */
     }
 
@@ -182,6 +199,7 @@ int socket_recvfrom(int sockfd, void *buf, int max_len, uint8_t *src_ip_out, uin
     /* Advance the tail pointer (ring buffer) */
     sockets[sockfd].recv_tail = (sockets[sockfd].recv_tail + 1) % SOCKET_RECV_QUEUE_SIZE;
     sockets[sockfd].recv_count--;
+    spin_unlock_irqrestore(&socket_lock, flags);
 
     return copy_len;
 }
@@ -191,10 +209,12 @@ int socket_deliver_udp(uint16_t port, void *data, int len, uint8_t *src_ip, uint
      * Called from udp_rx() when a packet arrives.
      * Find the socket bound to this port and queue the packet.
      */
+    uint32_t flags = spin_lock_irqsave(&socket_lock);
     for (int i = 0; i < MAX_SOCKETS; i++) {
         if (sockets[i].in_use && sockets[i].bound_port == port) {
             /* Found the socket — check if queue is full */
             if (sockets[i].recv_count >= SOCKET_RECV_QUEUE_SIZE) {
+                spin_unlock_irqrestore(&socket_lock, flags);
                 printf("socket: Receive queue full for port %i, dropping packet\n", port);
                 return -1;
             }
@@ -215,6 +235,7 @@ int socket_deliver_udp(uint16_t port, void *data, int len, uint8_t *src_ip, uint
             /* Advance the head pointer */
             sockets[i].recv_head = (sockets[i].recv_head + 1) % SOCKET_RECV_QUEUE_SIZE;
             sockets[i].recv_count++;
+            spin_unlock_irqrestore(&socket_lock, flags);
 
             printf("socket: Delivered %i bytes to socket %i (port %i), queue=%i\n", copy_len, i, port,
                    sockets[i].recv_count);
@@ -223,6 +244,7 @@ int socket_deliver_udp(uint16_t port, void *data, int len, uint8_t *src_ip, uint
     }
 
     /* No socket bound to this port */
+    spin_unlock_irqrestore(&socket_lock, flags);
     return -1;
 }
 
@@ -232,6 +254,8 @@ int socket_close(int sockfd) {
     }
 
     printf("socket: Closing socket %i (port %i)\n", sockfd, sockets[sockfd].bound_port);
+    uint32_t flags = spin_lock_irqsave(&socket_lock);
     memset(&sockets[sockfd], 0, sizeof(struct socket));
+    spin_unlock_irqrestore(&socket_lock, flags);
     return 0;
 }
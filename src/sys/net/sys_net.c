@@ -6,8 +6,8 @@
  * How a syscall works in ToyOS (step by step):
  *
  *   USER SPACE (ring 3):
- *     push 2           ; arg: SOCK_DGRAM
- *     mov eax, 16      ; syscall number: SYSTEM_COMMAND16_SOCKET
+ *     mov ebx, 2       ; arg: SOCK_DGRAM
+ *     mov eax, 16 | TOYOS_SYSCALL_REGISTER_ABI  ; syscall number: SYSTEM_COMMAND16_SOCKET
  *     int 0x80         ; software interrupt — CPU switches to ring 0
  *
  *   KERNEL SPACE (ring 0):
@@ -15,7 +15,7 @@
  *       → sys_handler() saves task state, calls sys_handle_command(16, frame)
  *       → sys_handle_command() looks up sys_commands[16]
  *       → calls sys_command16_socket(frame)
- *       → reads arg from user stack: task_get_stack_item(task, 0) → 2
+ *       → reads arg from the saved EBX: sys_get_argument(frame, 0) → 2
  *       → calls socket_create(2)
  *       → returns socket descriptor (e.g., 0) as void*
  *     int80h returns to user space with result in EAX
@@ -35,11 +35,11 @@
  * sys_command16_socket — create a socket
  *
  * User calls: int sockfd = toyos_socket(SOCK_DGRAM);
- * Stack:      [type]
+ * Args:       EBX = type
  * Returns:    socket descriptor (>= 0) or error (< 0)
  */
 void *sys_command16_socket(struct interrupt_frame *frame) {
-    int type = (int)task_get_stack_item(task_current(), 0);
+    int type = (int)sys_get_argument(frame, 0);
     int sockfd = socket_create(type);
     return (void *)(intptr_t)sockfd;
 }
@@ -48,51 +48,67 @@ void *sys_command16_socket(struct interrupt_frame *frame) {
  * sys_command17_bind — bind a socket to a port
  *
  * User calls: toyos_bind(sockfd, port);
- * Stack:      [port, sockfd]  (pushed right-to-left)
+ * Args:       EBX = sockfd, ECX = port
  * Returns:    0 on success, -1 on error
  */
 void *sys_command17_bind(struct interrupt_frame *frame) {
-    int sockfd = (int)task_get_stack_item(task_current(), 0);
-    uint16_t port = (uint16_t)(int)task_get_stack_item(task_current(), 1);
+    int sockfd = (int)sys_get_argument(frame, 0);
+    uint16_t port = (uint16_t)(int)sys_get_argument(frame, 1);
     int res = socket_bind(sockfd, port);
     return (void *)(intptr_t)res;
 }
 
+int sys_net_sendto(struct task *task, int sockfd, void *user_buf, int len, uint8_t *dst_ip, uint16_t dst_port) {
+    if (len < 0 || len > SOCKET_MAX_PACKET_SIZE) {
+        return -1;
+    }
+
+    /*
+     * The buffer is in the user's address space. copy_from_user() walks
+     * the task's page tables page by page, so it may span pages that are
+     * not physically contiguous, and a bad pointer fails with -EFAULT.
+     */
+    uint8_t buf[SOCKET_MAX_PACKET_SIZE];
+    if (copy_from_user(task, buf, user_buf, len) < 0) {
+        return -1;
+    }
+
+    return socket_sendto(sockfd, buf, len, dst_ip, dst_port);
+}
+
+int sys_net_recvfrom(struct task *task, int sockfd, void *user_buf, int max_len, uint8_t *src_ip,
+                     uint16_t *src_port) {
+    uint8_t buf[SOCKET_MAX_PACKET_SIZE];
+    if (max_len > SOCKET_MAX_PACKET_SIZE) {
+        max_len = SOCKET_MAX_PACKET_SIZE;
+    }
+
+    int res = socket_recvfrom(sockfd, buf, max_len, src_ip, src_port);
+    if (res > 0 && copy_to_user(task, user_buf, buf, res) < 0) {
+        return -1;
+    }
+
+    return res;
+}
+
 /*
  * sys_command18_sendto — send a UDP packet
  *
  * User calls: toyos_sendto(&args);
- * Stack:      [pointer to sendto_args struct]
+ * Args:       EBX = pointer to sendto_args struct
  *
- * We use a struct because sendto has 5 parameters — too many to push
- * individually. The user packs them into a sendto_args struct and
- * pushes a single pointer.
+ * We use a struct because sendto has 5 parameters. The user packs them
+ * into a sendto_args struct and passes a single pointer.
  *
  * Returns: bytes sent or -1 on error
  */
 void *sys_command18_sendto(struct interrupt_frame *frame) {
-    /*
-     * Get the pointer to the args struct from the user stack.
-     * This is a virtual address in the user's address space.
-     * task_virtual_address_to_physical() walks the page tables
-     * to find the actual physical address the kernel can read.
-     */
-    void *user_ptr = task_get_stack_item(task_current(), 0);
-    struct sendto_args *args = task_virtual_address_to_physical(task_current(), user_ptr);
-    if (!args) {
+    struct sendto_args args;
+    if (copy_from_user(task_current(), &args, sys_get_argument(frame, 0), sizeof(args)) < 0) {
         return (void *)(intptr_t)-1;
     }
 
-    /*
-     * The buf pointer inside args is ALSO a user virtual address.
-     * Convert it too so we can read the actual data.
-     */
-    void *buf_phys = task_virtual_address_to_physical(task_current(), args->buf);
-    if (!buf_phys) {
-        return (void *)(intptr_t)-1;
-    }
-
-    int res = socket_sendto(args->sockfd, buf_phys, args->len, args->dst_ip, args->dst_port);
+    int res = sys_net_sendto(task_current(), args.sockfd, args.buf, args.len, args.dst_ip, args.dst_port);
     return (void *)(intptr_t)res;
 }
 
@@ -100,7 +116,7 @@ void *sys_command18_sendto(struct interrupt_frame *frame) {
  * sys_command19_recvfrom — receive a UDP packet
  *
  * User calls: int n = toyos_recvfrom(&args);
- * Stack:      [pointer to recvfrom_args struct]
+ * Args:       EBX = pointer to recvfrom_args struct
  *
  * The kernel fills args->buf with data, and args->src_ip / args->src_port
  * with the sender's address. The user can read these after the call returns.
@@ -108,27 +124,28 @@ void *sys_command18_sendto(struct interrupt_frame *frame) {
  * Returns: bytes received, 0 if nothing available, -1 on error
  */
 void *sys_command19_recvfrom(struct interrupt_frame *frame) {
-    void *user_ptr = task_get_stack_item(task_current(), 0);
-    struct recvfrom_args *args = task_virtual_address_to_physical(task_current(), user_ptr);
-    if (!args) {
-        return (void *)(intptr_t)-1;
-    }
-
-    void *buf_phys = task_virtual_address_to_physical(task_current(), args->buf);
-    if (!buf_phys) {
+    void *user_args = sys_get_argument(frame, 0);
+    struct recvfrom_args args;
+    if (copy_from_user(task_current(), &args, user_args, sizeof(args)) < 0) {
         return (void *)(intptr_t)-1;
     }
 
     /*
-     * recvfrom fills the buffer and writes the sender's IP/port
-     * directly into the args struct (which is in user memory,
-     * but we have the physical address so the kernel can write there).
+     * The sender's IP/port are written back into the user's args struct.
      *
      * We read src_port into a local variable to avoid taking the
      * address of a packed struct member (which could be misaligned).
      */
     uint16_t src_port = 0;
-    int res = socket_recvfrom(args->sockfd, buf_phys, args->max_len, args->src_ip, &src_port);
-    args->src_port = src_port;
+    int res = sys_net_recvfrom(task_current(), args.sockfd, args.buf, args.max_len, args.src_ip, &src_port);
+    if (res <= 0) {
+        return (void *)(intptr_t)res;
+    }
+
+    args.src_port = src_port;
+    if (copy_to_user(task_current(), user_args, &args, sizeof(args)) < 0) {
+        return (void *)(intptr_t)-1;
+    }
+
     return (void *)(intptr_t)res;
 }
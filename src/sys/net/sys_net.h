@@ -2,6 +2,9 @@
 #define __SYS_NET_H
 
 #include "idt/idt.h"
+#include <stdint.h>
+
+struct task;
 
 /*
  * NETWORK SYSTEM CALL HANDLERS
@@ -10,15 +13,15 @@
  * user programs invoke network operations.
  *
  * Each handler:
- *   1. Reads arguments from the user's stack via task_get_stack_item()
- *   2. Converts user-space pointers to physical addresses
+ *   1. Reads arguments from the saved registers via sys_get_argument()
+ *   2. Copies user-space buffers in and out with copy_from_user()/copy_to_user()
  *   3. Calls the appropriate kernel socket function
  *   4. Returns the result (which becomes EAX in user space)
  *
  * The user-space calling convention is:
- *   push arg_N        ; arguments pushed right-to-left
- *   push arg_1
- *   mov eax, CMD_NUM  ; syscall number in EAX
+ *   mov ebx, arg_1    ; arguments in EBX, ECX, EDX, ESI, EDI
+ *   mov ecx, arg_2
+ *   mov eax, CMD_NUM | TOYOS_SYSCALL_REGISTER_ABI  ; syscall number in EAX
  *   int 0x80          ; trap to kernel
  *   ; result in EAX
  */
@@ -26,10 +29,10 @@
 /*
  * Argument structures for sendto/recvfrom.
  *
- * These have too many parameters to pass individually on the stack
+ * These have too many parameters to pass individually in registers
  * (5 params each), so the user program packs them into a struct and
- * pushes a single pointer. The kernel dereferences the pointer after
- * converting it from the user's virtual address to a physical address.
+ * passes a single pointer. The kernel copies the struct in with
+ * copy_from_user() before reading it.
  *
  * This is similar to how Linux handles sendto/recvfrom with the
  * socketcall() multiplexer on 32-bit x86.
@@ -56,4 +59,17 @@ void *sys_command17_bind(struct interrupt_frame *frame);
 void *sys_command18_sendto(struct interrupt_frame *frame);
 void *sys_command19_recvfrom(struct interrupt_frame *frame);
 
+/*
+ * Send and receive with a buffer in a task's address space.
+ *
+ * Shared by the syscall handlers above and the submission ring, which
+ * already has the arguments unpacked. The buffer is copied through a
+ * kernel buffer of at most SOCKET_MAX_PACKET_SIZE bytes.
+ *
+ * Returns: bytes sent/received, 0 if nothing available, -1 on error
+ */
+int sys_net_sendto(struct task *task, int sockfd, void *user_buf, int len, uint8_t *dst_ip, uint16_t dst_port);
+int sys_net_recvfrom(struct task *task, int sockfd, void *user_buf, int max_len, uint8_t *src_ip,
+                     uint16_t *src_port);
+
 #endif
@@ -0,0 +1,117 @@
+#include "ring.h"
+#include "idt/idt.h"
+#include "kernel.h"
+#include "keyboard/keyboard.h"
+#include "memory/heap/kheap.h"
+#include "memory/paging/paging.h"
+#include "status.h"
+#include "sys/net/sys_net.h"
+#include "task/process.h"
+#include "task/task.h"
+#include "terminal/terminal.h"
+
+/**
+ * @brief Performs a single submission
+ *
+ * @param task The task whose address space the submission's buffer is in.
+ * @param sqe A kernel copy of the submission.
+ * @param cqe The completion to fill.
+ */
+static void sys_ring_submit(struct task *task, struct ring_sqe *sqe, struct ring_cqe *cqe) {
+    switch (sqe->opcode) {
+    case RING_OP_NOP:
+        cqe->res = 0;
+        break;
+
+    case RING_OP_PUTCHAR:
+        terminal_update_cursor();
+        terminal_writechar((char)sqe->len, VGA_COLOR_WHITE, VGA_COLOR_BLUE);
+        cqe->res = 0;
+        break;
+
+    case RING_OP_GETKEY:
+        cqe->res = keyboard_pop();
+        break;
+
+    case RING_OP_SENDTO:
+        cqe->res = sys_net_sendto(task, sqe->fd, sqe->buf, sqe->len, sqe->ip, sqe->port);
+        break;
+
+    case RING_OP_RECVFROM:
+        cqe->res = sys_net_recvfrom(task, sqe->fd, sqe->buf, sqe->len, cqe->ip, &cqe->port);
+        break;
+
+    default:
+        cqe->res = -EINVARG;
+        break;
+    }
+}
+
+/**
+ * @brief Processes pending submissions while there is room for their completions
+ *
+ * @param process The process owning the rings.
+ * @return The number of submissions processed.
+ */
+static int sys_ring_process(struct process *process) {
+    struct sys_ring *ring = process->ring;
+    int count = 0;
+    while (ring->sq_head != ring->sq_tail && ring->cq_tail - ring->cq_head < TOYOS_RING_ENTRIES) {
+        // The process can change the entry at any time, so it is only read once
+        struct ring_sqe sqe = ring->sqes[ring->sq_head % TOYOS_RING_ENTRIES];
+        ring->sq_head++;
+
+        struct ring_cqe cqe = {.user_data = sqe.user_data};
+        sys_ring_submit(process->task, &sqe, &cqe);
+
+        // The entry must be complete before the process can see it
+        ring->cqes[ring->cq_tail % TOYOS_RING_ENTRIES] = cqe;
+        __sync_synchronize();
+        ring->cq_tail++;
+        count++;
+    }
+
+    return count;
+}
+
+void *sys_command24_ring_setup(struct interrupt_frame *frame) {
+    struct process *process = task_current()->process;
+    if (process->ring) {
+        return process->ring;
+    }
+
+    // Heap blocks are page aligned, so the rings share no page with other kernel data
+    struct sys_ring *ring = kzalloc(sizeof(struct sys_ring));
+    if (!ring) {
+        return ERROR(-ENOMEM);
+    }
+
+    int res = paging_map_to(process->task->page_directory, ring, ring, paging_align_address((void *)(ring + 1)),
+                            PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    if (res < 0) {
+        kfree(ring);
+        return ERROR(res);
+    }
+
+    ring->entries = TOYOS_RING_ENTRIES;
+    ring->flags = (uint32_t)sys_get_argument(frame, 0);
+    process->ring = ring;
+    return ring;
+}
+
+void *sys_command25_ring_enter(struct interrupt_frame *frame) {
+    struct process *process = task_current()->process;
+    if (!process->ring) {
+        return ERROR(-EINVARG);
+    }
+
+    return (void *)sys_ring_process(process);
+}
+
+void sys_ring_poll(struct process *process) {
+    if (!process || !process->ring || !(process->ring->flags & RING_SETUP_POLL)) {
+        return;
+    }
+
+    sys_ring_process(process);
+}
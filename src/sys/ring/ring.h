@@ -0,0 +1,102 @@
+#ifndef _SYS_RING_H_
+#define _SYS_RING_H_
+
+#include "config.h"
+#include <stdint.h>
+
+// Forward declarations.
+struct interrupt_frame;
+struct process;
+
+/**
+ * @brief Operations that can be queued on a submission ring.
+ */
+enum RING_OPS {
+    RING_OP_NOP,      /**< Completes immediately with a result of 0. */
+    RING_OP_PUTCHAR,  /**< Writes the character in 'len' to the console. */
+    RING_OP_GETKEY,   /**< Completes with the next key press, or 0 if there is none. */
+    RING_OP_SENDTO,   /**< Sends 'len' bytes from 'buf' on socket 'fd' to 'ip':'port'. */
+    RING_OP_RECVFROM, /**< Receives up to 'len' bytes into 'buf' from socket 'fd'. */
+};
+
+/**
+ * @brief Ring setup flags.
+ */
+#define RING_SETUP_POLL 0x01 /**< Submissions are also picked up at timer ticks, without a doorbell. */
+
+/**
+ * @brief Submission queue entry, filled by the process
+ */
+struct ring_sqe {
+    uint32_t opcode;    /**< One of RING_OPS. */
+    int32_t fd;         /**< Socket descriptor. */
+    void *buf;          /**< Buffer in the process's address space. */
+    int32_t len;        /**< Length of the buffer, or the character for RING_OP_PUTCHAR. */
+    uint8_t ip[4];      /**< Destination address for RING_OP_SENDTO. */
+    uint16_t port;      /**< Destination port for RING_OP_SENDTO. */
+    uint16_t reserved;  /**< Unused. */
+    uint32_t user_data; /**< Copied to the completion. */
+};
+
+/**
+ * @brief Completion queue entry, filled by the kernel
+ */
+struct ring_cqe {
+    uint32_t user_data; /**< The user_data of the submission. */
+    int32_t res;        /**< The result of the operation, as the matching system call would return it. */
+    uint8_t ip[4];      /**< Source address for RING_OP_RECVFROM. */
+    uint16_t port;      /**< Source port for RING_OP_RECVFROM. */
+    uint16_t reserved;  /**< Unused. */
+};
+
+/**
+ * @brief Submission and completion rings shared between a process and the kernel
+ *
+ * The process produces submissions at sq_tail and consumes completions at cq_head, the kernel
+ * consumes submissions at sq_head and produces completions at cq_tail. The counters only ever
+ * increase, and index the entries modulo TOYOS_RING_ENTRIES.
+ */
+struct sys_ring {
+    volatile uint32_t sq_head; /**< Next submission the kernel will consume. */
+    volatile uint32_t sq_tail; /**< Next submission the process will fill. */
+    volatile uint32_t cq_head; /**< Next completion the process will consume. */
+    volatile uint32_t cq_tail; /**< Next completion the kernel will fill. */
+    uint32_t entries;          /**< Number of entries in each ring (TOYOS_RING_ENTRIES). */
+    uint32_t flags;            /**< RING_SETUP_* flags. */
+    struct ring_sqe sqes[TOYOS_RING_ENTRIES];
+    struct ring_cqe cqes[TOYOS_RING_ENTRIES];
+};
+
+/**
+ * @brief System command handler for setting up the process's rings.
+ *
+ * This function is called when the system command SYSTEM_COMMAND24_RING_SETUP is invoked.
+ * The rings are mapped writable into the process and stay valid until it exits. Calling it
+ * again returns the existing rings.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to the rings, or an error code.
+ */
+void *sys_command24_ring_setup(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for the ring doorbell.
+ *
+ * This function is called when the system command SYSTEM_COMMAND25_RING_ENTER is invoked.
+ * It processes every pending submission for which there is room in the completion ring.
+ *
+ * @param frame The interrupt frame.
+ * @return The number of submissions processed, or an error code.
+ */
+void *sys_command25_ring_enter(struct interrupt_frame *frame);
+
+/**
+ * @brief Processes the pending submissions of a process that set up its rings with RING_SETUP_POLL.
+ *
+ * Called on timer ticks that interrupted the process in user mode, so no kernel locks are held.
+ *
+ * @param process The process.
+ */
+void sys_ring_poll(struct process *process);
+
+#endif
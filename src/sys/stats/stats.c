@@ -0,0 +1,78 @@
+#include "stats.h"
+#include "config.h"
+#include "disk/bcache.h"
+#include "idt/idt.h"
+#include "kernel.h"
+#include "locks/spinlock.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
+#include "status.h"
+#include "task/process.h"
+#include "task/task.h"
+
+void *sys_command20_lock_stats(struct interrupt_frame *frame) {
+    struct spinlock_info *info = (struct spinlock_info *)process_malloc(
+        task_current()->process, sizeof(struct spinlock_info) * TOYOS_MAX_SPINLOCKS);
+    if (!info) {
+        return ERROR(-ENOMEM);
+    }
+
+    // process_malloc zeroes the memory, so unused entries have an empty name
+    spin_lock_get_stats(info, TOYOS_MAX_SPINLOCKS);
+    return info;
+}
+
+void *sys_command22_irq_latency(struct interrupt_frame *frame) {
+    struct irq_latency_stats *stats =
+        (struct irq_latency_stats *)process_malloc(task_current()->process, sizeof(struct irq_latency_stats));
+    if (!stats) {
+        return ERROR(-ENOMEM);
+    }
+
+    idt_get_latency_stats(stats);
+    return stats;
+}
+
+void *sys_command26_syscall_stats(struct interrupt_frame *frame) {
+    int pid = (int)sys_get_argument(frame, 0);
+    int size = sizeof(struct syscall_stats) * TOYOS_SYSCALL_STATS_MAX;
+
+    // The process may exit at any time, so its counters are copied while the process table is locked
+    struct syscall_stats *snapshot = kzalloc(size);
+    if (!snapshot) {
+        return ERROR(-ENOMEM);
+    }
+
+    int res = OK;
+    if (pid >= 0) {
+        res = process_get_syscall_stats(pid, snapshot);
+    } else {
+        idt_get_syscall_stats(snapshot, NULL);
+    }
+
+    if (res < 0) {
+        kfree(snapshot);
+        return ERROR(res);
+    }
+
+    struct syscall_stats *stats = (struct syscall_stats *)process_malloc(task_current()->process, size);
+    if (!stats) {
+        kfree(snapshot);
+        return ERROR(-ENOMEM);
+    }
+
+    memcpy(stats, snapshot, size);
+    kfree(snapshot);
+    return stats;
+}
+
+void *sys_command29_bcache_stats(struct interrupt_frame *frame) {
+    struct bcache_stats *stats =
+        (struct bcache_stats *)process_malloc(task_current()->process, sizeof(struct bcache_stats));
+    if (!stats) {
+        return ERROR(-ENOMEM);
+    }
+
+    bcache_get_stats(stats);
+    return stats;
+}
@@ -0,0 +1,64 @@
+#ifndef _SYS_STATS_H_
+#define _SYS_STATS_H_
+
+// Forward declaration of interrupt_frame.
+struct interrupt_frame;
+
+/**
+ * @brief System command handler for fetching the spinlock statistics.
+ *
+ * This function is called when the system command SYSTEM_COMMAND20_LOCK_STATS is invoked.
+ * It returns an array of TOYOS_MAX_SPINLOCKS entries. Unused entries have an empty name.
+ *
+ * @warning The memory for the array is allocated from the current process's memory space
+ * and must be freed by the caller.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to the statistics array, or an error code.
+ */
+void *sys_command20_lock_stats(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for fetching the interrupt latency measurements.
+ *
+ * This function is called when the system command SYSTEM_COMMAND22_IRQ_LATENCY is invoked.
+ * It returns a single struct irq_latency_stats.
+ *
+ * @warning The memory for the structure is allocated from the current process's memory space
+ * and must be freed by the caller.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to the measurements, or an error code.
+ */
+void *sys_command22_irq_latency(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for fetching the system call statistics.
+ *
+ * This function is called when the system command SYSTEM_COMMAND26_SYSCALL_STATS is invoked.
+ * It returns an array of TOYOS_SYSCALL_STATS_MAX entries indexed by system call number, for the
+ * process whose ID is passed as the first argument, or for all processes if it is -1.
+ *
+ * @warning The memory for the array is allocated from the current process's memory space
+ * and must be freed by the caller.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to the statistics array, or an error code.
+ */
+void *sys_command26_syscall_stats(struct interrupt_frame *frame);
+
+/**
+ * @brief System command handler for fetching the buffer cache statistics.
+ *
+ * This function is called when the system command SYSTEM_COMMAND29_BCACHE_STATS is invoked.
+ * It returns a struct bcache_stats with the hit, miss and write-back counts of the cache.
+ *
+ * @warning The memory for the structure is allocated from the current process's memory space
+ * and must be freed by the caller.
+ *
+ * @param frame The interrupt frame.
+ * @return Pointer to the statistics, or an error code.
+ */
+void *sys_command29_bcache_stats(struct interrupt_frame *frame);
+
+#endif
@@ -6,15 +6,23 @@
 #include "./io/io.h"
 #include "./memory/heap.h"
 #include "./net/sys_net.h"
+#include "./ring/ring.h"
+#include "./stats/stats.h"
+#include "./disk/sys_disk.h"
 #include "./task/process.h"
 
 // For testing purposes
 static void *sys_command0_test(struct interrupt_frame *frame) {
-    int a = (int)task_get_stack_item(task_current(), 0);
-    int b = (int)task_get_stack_item(task_current(), 1);
+    int a = (int)sys_get_argument(frame, 0);
+    int b = (int)sys_get_argument(frame, 1);
     return (void *)(a + b);
 }
 
+// Does nothing, used to measure the cost of entering and leaving the kernel
+static void *sys_command23_null(struct interrupt_frame *frame) {
+    return NULL;
+}
+
 void sys_register_commands(void) {
     register_sys_command(SYSTEM_COMMAND0_TEST, sys_command0_test);
     register_sys_command(SYSTEM_COMMAND1_PRINT, sys_command1_print);
@@ -36,4 +44,16 @@ void sys_register_commands(void) {
     register_sys_command(SYSTEM_COMMAND17_BIND, sys_command17_bind);
     register_sys_command(SYSTEM_COMMAND18_SENDTO, sys_command18_sendto);
     register_sys_command(SYSTEM_COMMAND19_RECVFROM, sys_command19_recvfrom);
+    register_sys_command(SYSTEM_COMMAND20_LOCK_STATS, sys_command20_lock_stats);
+    register_sys_command(SYSTEM_COMMAND21_GET_PROCESS_STATS, sys_command21_get_process_stats);
+    register_sys_command(SYSTEM_COMMAND22_IRQ_LATENCY, sys_command22_irq_latency);
+    register_sys_command(SYSTEM_COMMAND23_NULL, sys_command23_null);
+    register_sys_command(SYSTEM_COMMAND24_RING_SETUP, sys_command24_ring_setup);
+    register_sys_command(SYSTEM_COMMAND25_RING_ENTER, sys_command25_ring_enter);
+    register_sys_command(SYSTEM_COMMAND26_SYSCALL_STATS, sys_command26_syscall_stats);
+    register_sys_command(SYSTEM_COMMAND27_WRITE, sys_command27_write);
+    register_sys_command(SYSTEM_COMMAND28_DISK_READ, sys_command28_disk_read);
+    register_sys_command(SYSTEM_COMMAND29_BCACHE_STATS, sys_command29_bcache_stats);
+    register_sys_command(SYSTEM_COMMAND30_SYNC, sys_command30_sync);
+    register_sys_command(SYSTEM_COMMAND31_STATFS, sys_command31_statfs);
 }
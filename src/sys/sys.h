@@ -24,7 +24,19 @@ enum SYSTEM_COMMANDS {
     SYSTEM_COMMAND16_SOCKET,
     SYSTEM_COMMAND17_BIND,
     SYSTEM_COMMAND18_SENDTO,
-    SYSTEM_COMMAND19_RECVFROM
+    SYSTEM_COMMAND19_RECVFROM,
+    SYSTEM_COMMAND20_LOCK_STATS,
+    SYSTEM_COMMAND21_GET_PROCESS_STATS,
+    SYSTEM_COMMAND22_IRQ_LATENCY,
+    SYSTEM_COMMAND23_NULL,
+    SYSTEM_COMMAND24_RING_SETUP,
+    SYSTEM_COMMAND25_RING_ENTER,
+    SYSTEM_COMMAND26_SYSCALL_STATS,
+    SYSTEM_COMMAND27_WRITE,
+    SYSTEM_COMMAND28_DISK_READ,
+    SYSTEM_COMMAND29_BCACHE_STATS,
+    SYSTEM_COMMAND30_SYNC,
+    SYSTEM_COMMAND31_STATFS
 };
 
 /**
@@ -1,8 +1,10 @@
 #include "process.h"
 #include "config.h"
+#include "fs/file.h"
 #include "idt/idt.h"
 #include "kernel.h"
-#include "locks/spinlock.h"
+#include "memory/heap/kheap.h"
+#include "memory/memory.h"
 #include "status.h"
 #include "stdlib/printf.h"
 #include "stdlib/string.h"
@@ -10,16 +12,15 @@
 #include "task/task.h"
 
 /**
- * @brief Spinlock for active processes.
+ * @brief Set while a child process started by the shell is running.
  *
- * Used for parent processes who wait for child processes to finish (ex. shell).
+ * Used for parent processes who wait for child processes to finish (ex. shell). This is not a
+ * spinlock since it is set and cleared by different tasks and is held across task switches.
  */
-static struct spinlock_t lock = {
-    .locked = 0,
-};
+static volatile bool child_running = false;
 
 void *sys_command6_process_load_start(struct interrupt_frame *frame) {
-    void *filename_user_ptr = task_get_stack_item(task_current(), 0);
+    void *filename_user_ptr = sys_get_argument(frame, 0);
     char filename[TOYOS_MAX_PATH];
     int res = copy_string_from_task(task_current(), filename_user_ptr, filename, sizeof(filename));
     if (res < 0) {
@@ -27,7 +28,7 @@ void *sys_command6_process_load_start(struct interrupt_frame *frame) {
     }
 
     char path[TOYOS_MAX_PATH];
-    strcat(path, "0:/");
+    strcpy(path, fs_get_program_drive());
     strcat(path, filename);
     strcat(path, ".elf");
 
@@ -37,6 +38,8 @@ void *sys_command6_process_load_start(struct interrupt_frame *frame) {
         goto out;
     }
 
+    // Nothing may preempt us between switching to the new task and entering it
+    disable_interrupt();
     task_switch(process->task);
     task_return(&process->task->registers);
 
@@ -46,91 +49,203 @@ out:
 
 void *sys_command7_process_exit(struct interrupt_frame *frame) {
     struct process *process = task_current()->process;
+
+    // The task is freed here, so it must not be preempted before the next task is entered
+    disable_interrupt();
     process_terminate(process);
     task_next();
     return NULL;
 }
 
 void *sys_command8_get_program_arguments(struct interrupt_frame *frame) {
-    struct process *process = task_current()->process;
-    struct process_arguments *arguments =
-        task_virtual_address_to_physical(task_current(), task_get_stack_item(task_current(), 0));
+    struct process_arguments arguments;
+    process_get_arguments(task_current()->process, &arguments.argc, &arguments.argv);
 
-    process_get_arguments(process, &arguments->argc, &arguments->argv);
-    return 0;
+    int res = copy_to_user(task_current(), sys_get_argument(frame, 0), &arguments, sizeof(arguments));
+    return ERROR(res);
+}
+
+/**
+ * @brief Frees a command argument list copied by sys_copy_command_arguments()
+ *
+ * @param root The first argument in the list.
+ */
+static void sys_free_command_arguments(struct command_argument *root) {
+    while (root) {
+        struct command_argument *next = root->next;
+        kfree(root);
+        root = next;
+    }
+}
+
+/**
+ * @brief Copies a command argument list from the current task's memory
+ *
+ * @param user_root The first argument in the task's memory.
+ * @param root Set to the copied list, which must be freed with sys_free_command_arguments().
+ * @return 0 on success, -EINVARG if the list has more than TOYOS_MAX_PROGRAM_ARGUMENTS entries, error code on
+ * failure.
+ */
+static int sys_copy_command_arguments(struct command_argument *user_root, struct command_argument **root) {
+    int res = OK;
+    int count = 0;
+    struct command_argument **tail = root;
+    *root = NULL;
+    while (user_root) {
+        // The list is in the task's memory, which may link it into a cycle
+        if (++count > TOYOS_MAX_PROGRAM_ARGUMENTS) {
+            res = -EINVARG;
+            goto out;
+        }
+
+        struct command_argument *argument = kzalloc(sizeof(struct command_argument));
+        if (!argument) {
+            res = -ENOMEM;
+            goto out;
+        }
+
+        *tail = argument;
+        res = copy_from_user(task_current(), argument, user_root, sizeof(struct command_argument));
+        if (res < 0) {
+            goto out;
+        }
+
+        argument->argument[sizeof(argument->argument) - 1] = 0;
+        user_root = argument->next;
+        argument->next = NULL;
+        tail = &argument->next;
+    }
+
+out:
+    if (res < 0) {
+        sys_free_command_arguments(*root);
+        *root = NULL;
+    }
+
+    return res;
 }
 
 void *sys_command9_invoke_system_command(struct interrupt_frame *frame) {
-    struct command_argument *arguments =
-        task_virtual_address_to_physical(task_current(), task_get_stack_item(task_current(), 0));
-    if (!arguments || strlen(arguments[0].argument) == 0) {
-        return ERROR(-EINVARG);
+    struct command_argument *root_command_argument = NULL;
+    int res = sys_copy_command_arguments(sys_get_argument(frame, 0), &root_command_argument);
+    if (res < 0) {
+        return ERROR(res);
+    }
+
+    if (!root_command_argument || strlen(root_command_argument->argument) == 0) {
+        res = -EINVARG;
+        goto out;
     }
 
-    struct command_argument *root_command_argument = &arguments[0];
     const char *program_name = root_command_argument->argument;
 
     char path[TOYOS_MAX_PATH];
-    strcat(path, "0:/");
+    strcpy(path, fs_get_program_drive());
     strcat(path, program_name);
     strcat(path, ".elf");
 
     struct process *process = 0;
-    int res = process_load_and_switch(path, &process);
+    res = process_load_and_switch(path, &process);
     if (res < 0) {
         alertk("Command not recognized.\n\n");
-        return ERROR(res);
+        goto out;
     }
 
     res = process_inject_arguments(process, root_command_argument);
     if (res < 0) {
-        return ERROR(res);
+        goto out;
     }
 
+    sys_free_command_arguments(root_command_argument);
+
+    // Nothing may preempt us between switching to the new task and entering it
+    disable_interrupt();
     task_switch(process->task);
-    spin_lock(&lock);
+    child_running = true;
     task_return(&process->task->registers);
 
     // Should never reach here: should be in user mode for new process by now
     panick("task_switch failed\n");
     return 0;
+
+out:
+    sys_free_command_arguments(root_command_argument);
+    return ERROR(res);
+}
+
+/**
+ * @brief Copies the resource usage of every live process
+ *
+ * @param snapshot Set to an array allocated with kzalloc(), which must be freed by the caller.
+ * @return The number of entries, or error code on failure.
+ */
+static int sys_snapshot_processes(struct process_stats_info **snapshot) {
+    int max = process_get_table_size();
+    *snapshot = kzalloc(sizeof(struct process_stats_info) * (max > 0 ? max : 1));
+    if (!*snapshot) {
+        return -ENOMEM;
+    }
+
+    return process_get_stats(*snapshot, max);
 }
 
 void *sys_command11_get_processes(struct interrupt_frame *frame) {
-    struct process_info *info = (struct process_info *)process_malloc(
-        task_current()->process, sizeof(struct process_info) * TOYOS_MAX_PROCESSES);
+    struct process_stats_info *snapshot = NULL;
+    int count = sys_snapshot_processes(&snapshot);
+    if (count < 0) {
+        return ERROR(count);
+    }
+
+    // one entry per process plus a terminating entry with an id of -1
+    struct process_info *info = (struct process_info *)process_malloc(task_current()->process,
+                                                                      sizeof(struct process_info) * (count + 1));
     if (!info) {
+        kfree(snapshot);
         return ERROR(-ENOMEM);
     }
 
-    // keep separate index for info array (note: not mapped 1:1 with pid)
-    int index = 0;
-
-    for (int pid = 0; pid < TOYOS_MAX_PROCESSES; pid++) {
-        // indicates no process
-        info[index].id = -1;
+    for (int i = 0; i < count; i++) {
+        info[i].id = snapshot[i].id;
+        strncpy(info[i].filename, snapshot[i].filename, sizeof(info[i].filename) - 1);
+    }
 
-        struct process *process = process_get(pid);
-        if (!process) {
-            goto next;
-        }
+    info[count].id = -1;
+    kfree(snapshot);
+    return info;
+}
 
-        info[index].id = process->id;
-        strcpy(info[index].filename, process->filename);
+void *sys_command21_get_process_stats(struct interrupt_frame *frame) {
+    struct process_stats_info *snapshot = NULL;
+    int count = sys_snapshot_processes(&snapshot);
+    if (count < 0) {
+        return ERROR(count);
+    }
 
-    next:
-        index += 1;
+    // one entry per process plus a terminating entry with an id of -1
+    struct process_stats_info *info = (struct process_stats_info *)process_malloc(
+        task_current()->process, sizeof(struct process_stats_info) * (count + 1));
+    if (!info) {
+        kfree(snapshot);
+        return ERROR(-ENOMEM);
     }
 
+    memcpy(info, snapshot, sizeof(struct process_stats_info) * count);
+    info[count].id = -1;
+    kfree(snapshot);
     return info;
 }
 
 void *sys_command12_check_lock(struct interrupt_frame *frame) {
-    return lock.locked ? ERROR(-EBUSY) : OK;
+    if (child_running) {
+        // Let the child run instead of returning straight into the caller's polling loop
+        task_yield();
+    }
+
+    return child_running ? ERROR(-EBUSY) : OK;
 }
 
 void *sys_command13_done(struct interrupt_frame *frame) {
-    spin_unlock(&lock);
+    child_running = false;
     return 0;
 }
 
@@ -150,7 +265,7 @@ void *sys_command15_kill(struct interrupt_frame *frame) {
         return ERROR(-EINVARG);
     }
 
-    int pid = (int)(uintptr_t)task_get_stack_item(current_task, 0);
+    int pid = (int)(uintptr_t)sys_get_argument(frame, 0);
     if (pid == 0) {
         return ERROR(-EINVARG);  // the shell is always running, cannot kill it
     }
@@ -160,7 +275,14 @@ void *sys_command15_kill(struct interrupt_frame *frame) {
         return ERROR(-EINVARG);
     }
 
-    int res = process_terminate(process);
+    if (process == current_task->process) {
+        // Killing ourselves is the same as exiting, there is no task left to return to
+        disable_interrupt();
+        process_terminate(process);
+        task_next();
+    }
+
+    int res = process_kill(process);
     if (res < 0) {
         return ERROR(res);
     }
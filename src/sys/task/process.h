@@ -92,11 +92,27 @@ void *sys_command14_fork(struct interrupt_frame *frame);
  * @brief System command handler for killing a process.
  *
  * This function is called when the system command SYSTEM_COMMAND15_KILL is invoked.
- * It terminates the specified process.
+ * It terminates the specified process, or, if the process is inside a system call, marks it
+ * so it terminates when the system call returns.
  *
  * @param frame The interrupt frame.
  * @return The return value of the system command.
  */
 void *sys_command15_kill(struct interrupt_frame *frame);
 
+/**
+ * @brief System command handler for getting resource usage of all processes.
+ *
+ * This function is called when the system command SYSTEM_COMMAND21_GET_PROCESS_STATS is invoked.
+ * It returns one entry per process with its CPU time, context switch and system call counts and
+ * resident memory, followed by an entry with an id of -1.
+ *
+ * @warning The memory for the list is allocated from the current process's memory space
+ * and must be freed by the caller.
+ *
+ * @param frame The interrupt frame.
+ * @return The return value of the system command.
+ */
+void *sys_command21_get_process_stats(struct interrupt_frame *frame);
+
 #endif
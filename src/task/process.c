@@ -1,7 +1,10 @@
 #include "process.h"
 #include "config.h"
+#include "cpu/cpu.h"
 #include "fs/file.h"
+#include "idt/idt.h"
 #include "kernel.h"
+#include "locks/spinlock.h"
 #include "loader/formats/elfloader.h"
 #include "memory/heap/kheap.h"
 #include "memory/memory.h"
@@ -13,8 +16,19 @@
 // The current process that is running
 struct process *current_process = NULL;
 
-// Array of processes
-static struct process *processes[TOYOS_MAX_PROCESSES] = {};
+// Table of processes indexed by process ID, grown on demand up to TOYOS_MAX_PROCESSES
+static struct process **processes = NULL;
+static int process_table_size = 0;
+
+// Stack of free process IDs, so allocating and releasing an ID is O(1)
+static uint16_t *process_free_ids = NULL;
+static int process_free_id_count = 0;
+
+// Number of live processes
+static int process_count = 0;
+
+// Protects the process table and process ID allocator
+static struct spinlock_t process_lock = SPINLOCK_INIT("process");
 
 /**
  * Loads a binary file into memory.
@@ -212,37 +226,137 @@ static int process_map_memory(struct process *process) {
     return OK;
 }
 
+/**
+ * Doubles the size of the process table and adds the new IDs to the free ID stack.
+ *
+ * @return 0 on success, -EISTKN if the table is at its maximum size, or -ENOMEM.
+ */
+static int process_table_grow(void) {
+    int new_size = process_table_size ? process_table_size * 2 : TOYOS_INITIAL_PROCESSES;
+    if (new_size > TOYOS_MAX_PROCESSES) {
+        new_size = TOYOS_MAX_PROCESSES;
+    }
+
+    if (new_size <= process_table_size) {
+        return -EISTKN;
+    }
+
+    struct process **new_table = kzalloc(new_size * sizeof(struct process *));
+    uint16_t *new_free_ids = kzalloc(new_size * sizeof(uint16_t));
+    if (!new_table || !new_free_ids) {
+        if (new_table) {
+            kfree(new_table);
+        }
+
+        if (new_free_ids) {
+            kfree(new_free_ids);
+        }
+
+        return -ENOMEM;
+    }
+
+    if (processes) {
+        memcpy(new_table, processes, process_table_size * sizeof(struct process *));
+        memcpy(new_free_ids, process_free_ids, process_free_id_count * sizeof(uint16_t));
+        kfree(processes);
+        kfree(process_free_ids);
+    }
+
+    // Push the new IDs highest first, so the lowest ID is handed out next
+    for (int id = new_size - 1; id >= process_table_size; id--) {
+        new_free_ids[process_free_id_count++] = id;
+    }
+
+    processes = new_table;
+    process_free_ids = new_free_ids;
+    process_table_size = new_size;
+    return OK;
+}
+
 /**
  * Retrieves a free slot in the process array.
  *
+ * The slot stays free until process_load_for_slot takes its ID.
+ *
  * @return The index of the free slot, or -EISTKN if no free slots are available.
  */
 static int process_get_free_slot(void) {
-    for (int i = 0; i < TOYOS_MAX_PROCESSES; i++) {
-        if (!processes[i]) {
-            return i;
+    if (process_free_id_count == 0) {
+        int res = process_table_grow();
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return process_free_ids[process_free_id_count - 1];
+}
+
+/**
+ * Removes a process ID from the free ID stack.
+ *
+ * @param id The process ID to take.
+ * @return 0 on success, or -EISTKN if the ID is not free.
+ */
+static int process_take_id(int id) {
+    for (int i = process_free_id_count - 1; i >= 0; i--) {
+        if (process_free_ids[i] == id) {
+            // IDs from process_get_free_slot are on top, so this is normally the first iteration
+            process_free_ids[i] = process_free_ids[process_free_id_count - 1];
+            process_free_id_count--;
+            return OK;
         }
     }
 
     return -EISTKN;
 }
 
+/**
+ * Returns a process ID to the free ID stack.
+ *
+ * @param id The process ID to release.
+ */
+static void process_release_id(int id) {
+    process_free_ids[process_free_id_count++] = id;
+}
+
 /**
  * Finds a free allocation index for a process.
  *
+ * The allocation table is created on the first allocation and doubled when it is full.
+ *
  * @param process The process to find an allocation index for.
  * @return The index of the free allocation, or -ENOMEM if no free allocations are available.
  */
 static int process_find_free_allocation_index(struct process *process) {
-    int res = -ENOMEM;
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
+    for (int i = 0; i < process->allocation_capacity; i++) {
         if (process->allocations[i].ptr == NULL) {
-            res = i;
-            break;
+            return i;
         }
     }
 
-    return res;
+    int capacity = process->allocation_capacity ? process->allocation_capacity * 2 : TOYOS_INITIAL_PROGRAM_ALLOCATIONS;
+    if (capacity > TOYOS_MAX_PROGRAM_ALLOCATIONS) {
+        capacity = TOYOS_MAX_PROGRAM_ALLOCATIONS;
+    }
+
+    if (capacity <= process->allocation_capacity) {
+        return -ENOMEM;
+    }
+
+    struct process_allocation *allocations = kzalloc(capacity * sizeof(struct process_allocation));
+    if (!allocations) {
+        return -ENOMEM;
+    }
+
+    int index = process->allocation_capacity;
+    if (process->allocations) {
+        memcpy(allocations, process->allocations, index * sizeof(struct process_allocation));
+        kfree(process->allocations);
+    }
+
+    process->allocations = allocations;
+    process->allocation_capacity = capacity;
+    return index;
 }
 
 /**
@@ -253,7 +367,7 @@ static int process_find_free_allocation_index(struct process *process) {
  * @return true if the pointer is allocated to the process, false otherwise.
  */
 static bool process_is_process_pointer(struct process *process, void *ptr) {
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
+    for (int i = 0; i < process->allocation_capacity; i++) {
         if (process->allocations[i].ptr == ptr)
             return true;
     }
@@ -268,7 +382,7 @@ static bool process_is_process_pointer(struct process *process, void *ptr) {
  * @param ptr The pointer to unjoin.
  */
 static void process_allocation_unjoin(struct process *process, void *ptr) {
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
+    for (int i = 0; i < process->allocation_capacity; i++) {
         if (process->allocations[i].ptr == ptr) {
             process->allocations[i].ptr = 0x00;
             ;
@@ -285,7 +399,11 @@ static void process_allocation_unjoin(struct process *process, void *ptr) {
  * @return The allocation structure, or NULL if not found.
  */
 static struct process_allocation *process_get_allocation_by_addr(struct process *process, void *addr) {
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
+    if (!addr) {
+        return 0;
+    }
+
+    for (int i = 0; i < process->allocation_capacity; i++) {
         if (process->allocations[i].ptr == addr)
             return &process->allocations[i];
     }
@@ -303,8 +421,16 @@ static struct process_allocation *process_get_allocation_by_addr(struct process
  * @return 0 on success, error code on failure.
  */
 int process_terminate_allocations(struct process *process) {
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        process_free(process, process->allocations[i].ptr);
+    for (int i = 0; i < process->allocation_capacity; i++) {
+        if (process->allocations[i].ptr) {
+            process_free(process, process->allocations[i].ptr);
+        }
+    }
+
+    if (process->allocations) {
+        kfree(process->allocations);
+        process->allocations = NULL;
+        process->allocation_capacity = 0;
     }
 
     return OK;
@@ -373,7 +499,7 @@ int process_free_program_data(struct process *process) {
  * is the last process in the array, it switches to the first process in the array.
  */
 void process_switch_to_any(void) {
-    for (int i = 0; i < TOYOS_MAX_PROCESSES; i++) {
+    for (int i = 0; i < process_table_size; i++) {
         if (processes[i]) {
             process_switch(processes[i]);
             return;
@@ -391,7 +517,11 @@ void process_switch_to_any(void) {
  * @param process The process to unlink.
  */
 static void process_unlink(struct process *process) {
+    spin_lock(&process_lock);
     processes[process->id] = NULL;
+    process_release_id(process->id);
+    process_count--;
+    spin_unlock(&process_lock);
 
     if (current_process == process) {
         process_switch_to_any();
@@ -524,15 +654,18 @@ out_err:
 int process_load(const char *filename, struct process **process) {
     int res = OK;
 
-    int process_slot = process_get_free_slot();
-    if (process_slot < 0) {
-        res = -EISTKN;
-        goto out;
-    }
+    // Another load may take the slot between finding it and loading into it, then try the next one
+    do {
+        spin_lock(&process_lock);
+        int process_slot = process_get_free_slot();
+        spin_unlock(&process_lock);
+        if (process_slot < 0) {
+            return -EISTKN;
+        }
 
-    res = process_load_for_slot(filename, process, process_slot);
+        res = process_load_for_slot(filename, process, process_slot);
+    } while (res == -EISTKN);
 
-out:
     return res;
 }
 
@@ -559,22 +692,89 @@ struct process *process_current(void) {
 }
 
 struct process *process_get(int process_id) {
-    if (process_id < 0 || process_id >= TOYOS_MAX_PROCESSES) {
+    if (process_id < 0 || process_id >= process_table_size) {
         return NULL;
     }
 
     return processes[process_id];
 }
 
+int process_get_count(void) {
+    return process_count;
+}
+
+int process_get_table_size(void) {
+    return process_table_size;
+}
+
+uint32_t process_get_resident_size(struct process *process) {
+    uint32_t size = TOYOS_USER_PROGRAM_STACK_SIZE;
+    if (process->filetype == PROCESS_FILETYPE_ELF) {
+        size += process->elf_file->in_memory_size;
+    } else {
+        size += process->size;
+    }
+
+    for (int i = 0; i < process->allocation_capacity; i++) {
+        size += process->allocations[i].size;
+    }
+
+    return size;
+}
+
+int process_get_stats(struct process_stats_info *info, int max) {
+    int count = 0;
+    spin_lock(&process_lock);
+    for (int pid = 0; pid < process_table_size && count < max; pid++) {
+        struct process *process = processes[pid];
+        if (!process) {
+            continue;
+        }
+
+        info[count].id = process->id;
+        strncpy(info[count].filename, process->filename, sizeof(info[count].filename) - 1);
+        info[count].runtime_cycles = process->task->stats.runtime_cycles;
+        info[count].context_switches = process->task->stats.context_switches;
+        info[count].syscalls = process->task->stats.syscalls;
+        info[count].resident_bytes = process_get_resident_size(process);
+        count++;
+    }
+
+    spin_unlock(&process_lock);
+    return count;
+}
+
+int process_get_syscall_stats(int process_id, struct syscall_stats *stats) {
+    int res = OK;
+    spin_lock(&process_lock);
+    struct process *process = process_get(process_id);
+    if (!process) {
+        res = -EINVARG;
+    } else {
+        idt_get_syscall_stats(stats, process);
+    }
+
+    spin_unlock(&process_lock);
+    return res;
+}
+
 int process_load_for_slot(const char *filename, struct process **process, int process_slot) {
     int res = OK;
     struct task *task = NULL;
     struct process *_process = NULL;
     void *program_stack_ptr = NULL;
 
-    if (process_get(process_slot) != OK) {
+    // Take the ID first, the lock is not held while the file is read since that may wait for the disk
+    spin_lock(&process_lock);
+    if (process_slot < 0 || process_slot >= process_table_size || process_get(process_slot) != OK) {
         res = -EISTKN;
-        goto out;
+    } else {
+        res = process_take_id(process_slot);
+    }
+
+    spin_unlock(&process_lock);
+    if (res < 0) {
+        return res;
     }
 
     _process = kzalloc(sizeof(struct process));  // zeores memory
@@ -613,7 +813,10 @@ int process_load_for_slot(const char *filename, struct process **process, int pr
 
     *process = _process;
 
+    spin_lock(&process_lock);
     processes[process_slot] = _process;
+    process_count++;
+    spin_unlock(&process_lock);
 
 out:
     if (ISERROR(res)) {
@@ -624,6 +827,10 @@ out:
         // \todo: see if better way to free the memory
         kfree(_process);
         kfree(program_stack_ptr);
+
+        spin_lock(&process_lock);
+        process_release_id(process_slot);
+        spin_unlock(&process_lock);
     }
 
     return res;
@@ -649,10 +856,42 @@ int process_terminate(struct process *process) {
     // Unlink the process from the process array.
     process_unlink(process);
 
+    if (process->keyboard) {
+        kfree(process->keyboard);
+    }
+
+    if (process->ring) {
+        kfree(process->ring);
+    }
+
+    if (process->syscall_stats) {
+        kfree(process->syscall_stats);
+    }
+
+    kfree(process);
+
 out:
     return res;
 }
 
+int process_kill(struct process *process) {
+    if (!process || !process->task) {
+        return -EINVARG;
+    }
+
+    // The task cannot run while it is being inspected, or it could enter the kernel in between
+    uint32_t flags = cpu_irq_save();
+    if (process->task->kernel_esp) {
+        process->task->kill_pending = true;
+        cpu_irq_restore(flags);
+        return OK;
+    }
+
+    int res = process_terminate(process);
+    cpu_irq_restore(flags);
+    return res;
+}
+
 uint16_t process_fork(struct process **out_process) {
     int res = OK;
     struct process *parent = process_current();
@@ -660,20 +899,15 @@ uint16_t process_fork(struct process **out_process) {
         return -EINVARG;
     }
 
-    int slot = process_get_free_slot();
-    if (slot < 0) {
-        return slot;
-    }
-
     struct process *child = 0;
-    res = process_load_for_slot(parent->filename, &child, slot);
+    res = process_load(parent->filename, &child);
     if (res < 0) {
         return res;
     }
 
     memcpy(child->stack, parent->stack, TOYOS_USER_PROGRAM_STACK_SIZE);
 
-    for (int i = 0; i < TOYOS_MAX_PROGRAM_ALLOCATIONS; i++) {
+    for (int i = 0; i < parent->allocation_capacity; i++) {
         if (parent->allocations[i].ptr) {
             void *newptr = process_malloc(child, parent->allocations[i].size);
             if (newptr) {
@@ -683,6 +917,7 @@ uint16_t process_fork(struct process **out_process) {
     }
 
     memcpy(&child->task->registers, &task_current()->registers, sizeof(struct registers));
+    fpu_task_copy(child->task, task_current());
     child->task->registers.eax = 0;  // Set return value to 0 for child process
 
     *out_process = child;
@@ -12,6 +12,10 @@
 
 typedef unsigned char process_filetype;
 
+// Forward declarations
+struct sys_ring;
+struct syscall_stats;
+
 /**
  * @struct process_allocation
  * @brief Represents a memory allocation for a process.
@@ -48,23 +52,48 @@ struct process_info {
     char filename[64];
 };
 
+/**
+ * @struct keyboard_buffer
+ * @brief Ring buffer of keys typed while a process is in the foreground.
+ */
+struct keyboard_buffer {
+    char buffer[TOYOS_KEYBOARD_BUFFER_SIZE]; /**< The buffer. */
+    int tail;                                /**< Tail index. */
+    int head;                                /**< Head index. */
+};
+
+/**
+ * @struct process_stats_info
+ * @brief Represents resource usage of a process.
+ */
+struct process_stats_info {
+    int id;                    /**< The process ID, or -1 for the entry terminating a list. */
+    char filename[64];         /**< The filename of the executable. */
+    uint64_t runtime_cycles;   /**< TSC cycles the process has been running. */
+    uint32_t context_switches; /**< Number of times the process was switched in. */
+    uint32_t syscalls;         /**< Number of system calls made by the process. */
+    uint32_t resident_bytes;   /**< Memory used by the program image, stack and heap allocations. */
+};
+
 /**
  * @struct process
  * @brief Represents a process in the system.
+ *
+ * The allocation table and keyboard buffer are allocated on first use, so processes that
+ * never allocate memory or read the keyboard stay small.
  */
 struct process {
     uint16_t id;                   /**< The process ID. */
     char filename[TOYOS_MAX_PATH]; /**< The filename of the executable. */
     struct task *task;             /**< The main task associated with the process. */
-    struct process_allocation allocations[TOYOS_MAX_PROGRAM_ALLOCATIONS]; /**< Memory allocations. */
-    void *stack;                                                          /**< Physical pointer to the stack memory. */
-    uint32_t size;                                                        /**< Size of the data pointed to by 'ptr'. */
-    struct keyboard_buffer {                                              /**< Keyboard buffer for the process. */
-        char buffer[TOYOS_KEYBOARD_BUFFER_SIZE];                          /**< The buffer. */
-        int tail;                                                         /**< Tail index. */
-        int head;                                                         /**< Head index. */
-    } keyboard;
-    process_filetype filetype;     /**< The type of file the process is. */
+    struct process_allocation *allocations; /**< Memory allocations (NULL until the first allocation). */
+    int allocation_capacity;                /**< Number of entries in 'allocations'. */
+    void *stack;                            /**< Physical pointer to the stack memory. */
+    uint32_t size;                          /**< Size of the data pointed to by 'ptr'. */
+    struct keyboard_buffer *keyboard;       /**< Keyboard buffer (NULL until the first key press). */
+    struct sys_ring *ring;                  /**< Submission and completion rings (NULL until set up). */
+    struct syscall_stats *syscall_stats;    /**< Per system call statistics (NULL until the first system call). */
+    process_filetype filetype;              /**< The type of file the process is. */
     union {                        /**< File data. */
         void *ptr;                 /**< Pointer to the process memory. */
         struct elf_file *elf_file; /**< Pointer to the ELF file structure. */
@@ -82,6 +111,11 @@ int process_load(const char *filename, struct process **process);
 
 /**
  * Loads a process into a specific slot.
+ *
+ * The slot must be a free process ID, otherwise -EISTKN is returned. Taking the ID returned by
+ * the process ID allocator is O(1); any other free ID is searched for. The ID is taken before
+ * the file is read, and the process table lock is not held while reading, so disk waits let
+ * other tasks run.
  * @param filename The name of the file to load.
  * @param process A pointer to the process structure to store the loaded process.
  * @param process_slot The slot to load the process into.
@@ -102,6 +136,45 @@ struct process *process_current(void);
  */
 struct process *process_get(int process_id);
 
+/**
+ * Retrieves the number of live processes.
+ * @return The number of processes.
+ */
+int process_get_count(void);
+
+/**
+ * Retrieves the current size of the process table.
+ *
+ * Every live process has an ID below this value, so it bounds loops over process_get().
+ * @return The number of process IDs in the table.
+ */
+int process_get_table_size(void);
+
+/**
+ * Retrieves the amount of memory owned by a process.
+ * @param process The process.
+ * @return The size of the program image, stack and heap allocations in bytes.
+ */
+uint32_t process_get_resident_size(struct process *process);
+
+/**
+ * Copies the resource usage of every live process.
+ *
+ * The process table is locked while the entries are copied, so processes cannot exit meanwhile.
+ * @param info Array to fill, the filenames must be zeroed by the caller.
+ * @param max Number of entries in the array.
+ * @return The number of entries filled.
+ */
+int process_get_stats(struct process_stats_info *info, int max);
+
+/**
+ * Copies the system call statistics of a process.
+ * @param process_id The process ID.
+ * @param stats Array of TOYOS_SYSCALL_STATS_MAX entries to fill.
+ * @return 0 on success, -EINVARG if there is no such process.
+ */
+int process_get_syscall_stats(int process_id, struct syscall_stats *stats);
+
 /**
  * Switches to the given process.
  * @param process The process to switch to.
@@ -148,6 +221,18 @@ void process_free(struct process *process, void *ptr);
  */
 int process_terminate(struct process *process);
 
+/**
+ * @brief Kills a process other than the current one.
+ *
+ * A process whose task was switched out inside the kernel, for example while waiting for the
+ * disk, may still have requests queued from its kernel stack and hold locks. It is only marked,
+ * and terminates itself once its system call is done. Any other process is terminated at once.
+ *
+ * @param process The process to kill.
+ * @return The status of the operation.
+ */
+int process_kill(struct process *process);
+
 /**
  * @brief Retrieves the arguments for a process.
  *
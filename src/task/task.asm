@@ -4,6 +4,7 @@ section .asm
 global restore_general_purpose_registers
 global task_return
 global user_registers
+global task_context_switch
 
 ; void task_return(struct registers* regs);
 ; Restores the state of a task and returns to user mode
@@ -65,3 +66,20 @@ user_registers:
     mov fs, ax
     mov gs, ax
     ret
+
+; void task_context_switch(uint32_t* old_esp, uint32_t new_esp);
+; Saves the callee-saved registers of the current kernel context and resumes another one
+task_context_switch:
+    mov eax, [esp+4]     ; Where to store the current stack pointer
+    mov edx, [esp+8]     ; The stack pointer of the context to resume
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp       ; Save the current context
+    mov esp, edx         ; Switch to the other kernel stack
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret                  ; Return into the resumed context
@@ -1,4 +1,5 @@
 #include "task.h"
+#include "cpu/cpu.h"
 #include "idt/idt.h"
 #include "kernel.h"
 #include "loader/formats/elfloader.h"
@@ -8,6 +9,8 @@
 #include "process.h"
 #include "status.h"
 #include "stdlib/string.h"
+#include "tss.h"
+#include "vvar.h"
 
 // The current task that is running
 struct task *current_task = NULL;
@@ -16,6 +19,24 @@ struct task *current_task = NULL;
 struct task *task_tail = NULL;
 struct task *task_head = NULL;
 
+// The task state segment, whose esp0 points at the kernel stack of the current task
+extern struct tss tss;
+
+// Kernel stack of a freed task that was still in use when the task was freed
+static void *task_dead_kernel_stack = NULL;
+
+// Stack pointer of abandoned kernel contexts (see task_next)
+static uint32_t task_discarded_esp = 0;
+
+// TSC value when the current task was switched in
+static uint64_t task_switched_at = 0;
+
+// Kernel preemption is disabled while this is non-zero
+static volatile uint32_t preempt_count = 0;
+
+// Set when the timer wanted to preempt the kernel while preemption was disabled
+static volatile bool need_resched = false;
+
 /**
  * @brief Initializes a task structure
  *
@@ -65,6 +86,8 @@ static void task_list_remove(struct task *task) {
 
     if (task == current_task) {
         current_task = next_task;
+        // The rest of the removed task's time slice is not charged to anyone
+        task_switched_at = cpu_read_tsc();
     }
 }
 
@@ -114,6 +137,12 @@ static int task_init(struct task *task, struct process *process) {
         return -ENOMEM;
     }
 
+    // The shared kernel data page sits between the top of the stack and the program
+    int res = vvar_map(task->page_directory);
+    if (res < 0) {
+        return res;
+    }
+
     // Set the ip to the program's entry point
     task->registers.ip = TOYOS_PROGRAM_VIRTUAL_ADDRESS;
     if (process->filetype == PROCESS_FILETYPE_ELF) {
@@ -124,11 +153,81 @@ static int task_init(struct task *task, struct process *process) {
     task->registers.cs = TOYOS_USER_CODE_SEGMENT;
     task->registers.esp = TOYOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START;
 
+    task->kernel_stack = kzalloc(TOYOS_KERNEL_STACK_SIZE);
+    if (!task->kernel_stack) {
+        return -ENOMEM;
+    }
+
     task->process = process;
 
     return OK;
 }
 
+/**
+ * @brief Gets the initial ring 0 stack pointer of a task
+ *
+ * @param task The task
+ * @return uint32_t The address just past the end of the task's kernel stack
+ */
+static uint32_t task_kernel_stack_top(struct task *task) {
+    return (uint32_t)task->kernel_stack + TOYOS_KERNEL_STACK_SIZE;
+}
+
+/**
+ * @brief Frees the kernel stack of a task
+ *
+ * A task that exits is freed while the kernel is still running on its kernel stack, so in
+ * that case the stack is released the next time a task is freed instead.
+ *
+ * @param task The task whose kernel stack to free
+ */
+static void task_free_kernel_stack(struct task *task) {
+    if (!task->kernel_stack) {
+        return;
+    }
+
+    uint32_t esp;
+    asm volatile("mov %%esp, %0" : "=r"(esp));
+    if (esp >= (uint32_t)task->kernel_stack && esp < task_kernel_stack_top(task)) {
+        if (task_dead_kernel_stack) {
+            kfree(task_dead_kernel_stack);
+        }
+
+        task_dead_kernel_stack = task->kernel_stack;
+        return;
+    }
+
+    kfree(task->kernel_stack);
+}
+
+/**
+ * @brief Entry point of a kernel context created by task_kernel_context_init
+ *
+ * Runs on the task's own kernel stack and enters user mode with the task's saved registers.
+ */
+static void task_kernel_entry(void) {
+    task_return(&task_current()->registers);
+}
+
+/**
+ * @brief Prepares a kernel context for a task that is not currently inside the kernel
+ *
+ * The context is laid out the way task_context_switch expects it, so that switching to it
+ * "returns" into task_kernel_entry at the top of the task's kernel stack.
+ *
+ * @param task The task
+ * @return uint32_t The stack pointer of the new context
+ */
+static uint32_t task_kernel_context_init(struct task *task) {
+    uint32_t *sp = (uint32_t *)task_kernel_stack_top(task);
+    *--sp = (uint32_t)task_kernel_entry;  // return address
+    *--sp = 0;                            // ebp
+    *--sp = 0;                            // ebx
+    *--sp = 0;                            // esi
+    *--sp = 0;                            // edi
+    return (uint32_t)sp;
+}
+
 /**
  * @brief Switches to page directory for a given task
  *
@@ -163,17 +262,21 @@ struct task *task_new(struct process *process) {
         goto out;
     }
 
+    // The timer walks the task list, so it must not see it half updated
+    uint32_t flags = cpu_irq_save();
     if (task_head == NULL) {
         // this is the first task
         task_head = task;
         task_tail = task;
         current_task = task;
-        goto out;
+        task_switched_at = cpu_read_tsc();
+    } else {
+        task_tail->next = task;
+        task->prev = task_tail;
+        task_tail = task;
     }
 
-    task_tail->next = task;
-    task->prev = task_tail;
-    task_tail = task;
+    cpu_irq_restore(flags);
 
 out:
     if (ISERROR(res)) {
@@ -192,44 +295,112 @@ struct task *task_get_next(void) {
     return current_task->next;
 }
 
-int copy_string_from_task(struct task *task, void *virtual, void *phys, int max) {
-    if (max >= PAGING_PAGE_SIZE || !task || !virtual || !phys) {
+/**
+ * @brief Translates a user address, checking that user mode may access the page
+ *
+ * The kernel page directory identity maps all physical memory, so the returned address can be
+ * accessed directly without switching to the task's page directory.
+ *
+ * @param task The task owning the address.
+ * @param virtual The user virtual address.
+ * @param write Whether the page will be written to.
+ * @param chunk Set to the number of bytes left before the next page boundary.
+ * @return The physical address, or NULL if user mode may not access the page.
+ */
+static void *task_user_address(struct task *task, uintptr_t virtual, bool write, size_t *chunk) {
+    // The first page is never mapped for user mode, and paging_get() cannot tell it apart
+    if (virtual < PAGING_PAGE_SIZE) {
+        return NULL;
+    }
+
+    uint32_t required = PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | (write ? PAGING_IS_WRITEABLE : 0);
+    uintptr_t page = virtual & ~(PAGING_PAGE_SIZE - 1);
+    uint32_t entry = paging_get(task->page_directory->directory_entry, (void *)page);
+    if ((entry & required) != required) {
+        return NULL;
+    }
+
+    *chunk = PAGING_PAGE_SIZE - (virtual - page);
+    return (void *)((entry & 0xfffff000) + (virtual - page));
+}
+
+int copy_from_user(struct task *task, void *dst, const void *src, size_t len) {
+    if (!task || !dst) {
         return -EINVARG;
     }
 
-    // Allocate memory in the kernel space
-    char *tmp = kzalloc(max);
-    if (!tmp) {
-        return -ENOMEM;
+    uint8_t *out = dst;
+    uintptr_t virtual = (uintptr_t)src;
+    while (len) {
+        size_t chunk = 0;
+        void *phys = task_user_address(task, virtual, false, &chunk);
+        if (!phys) {
+            return -EFAULT;
+        }
+
+        chunk = chunk < len ? chunk : len;
+        memcpy(out, phys, chunk);
+        out += chunk;
+        virtual += chunk;
+        len -= chunk;
     }
 
-    // Get the task's page directory and the old entry for the virtual address
-    uint32_t *task_directory = task->page_directory->directory_entry;
-    uint32_t old_entry = paging_get(task_directory, tmp);
+    return OK;
+}
+
+int copy_to_user(struct task *task, void *dst, const void *src, size_t len) {
+    if (!task || !src) {
+        return -EINVARG;
+    }
 
-    // Map the memory in the task's page directory to the kernel space using the temporary buffer
-    paging_map(task->page_directory, tmp, tmp, PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    const uint8_t *in = src;
+    uintptr_t virtual = (uintptr_t)dst;
+    while (len) {
+        size_t chunk = 0;
+        void *phys = task_user_address(task, virtual, true, &chunk);
+        if (!phys) {
+            return -EFAULT;
+        }
 
-    // Switch to the task's page directory and copy the string to the kernel space
-    paging_switch(task->page_directory);
-    strncpy(tmp, virtual, max);
+        chunk = chunk < len ? chunk : len;
+        memcpy(phys, (void *)in, chunk);
+        in += chunk;
+        virtual += chunk;
+        len -= chunk;
+    }
 
-    // Switch back to the kernel page directory
-    kernel_page();
+    return OK;
+}
 
-    // Unmap the memory in the task's page directory
-    int res = paging_set(task_directory, tmp, old_entry);
-    if (res < 0) {
-        res = -EIO;
-        goto out;
+int copy_string_from_task(struct task *task, void *virtual, void *phys, int max) {
+    if (!task || !virtual || !phys || max <= 0) {
+        return -EINVARG;
     }
 
-    // Copy the string to the physical address
-    strncpy(phys, tmp, max);
+    char *out = phys;
+    uintptr_t address = (uintptr_t)virtual;
+    int copied = 0;
+    while (copied < max - 1) {
+        size_t chunk = 0;
+        const char *in = task_user_address(task, address, false, &chunk);
+        if (!in) {
+            out[copied] = 0;
+            return -EFAULT;
+        }
 
-out:
-    kfree(tmp);
-    return res;
+        for (size_t i = 0; i < chunk && copied < max - 1; i++) {
+            out[copied] = in[i];
+            if (!in[i]) {
+                return OK;
+            }
+
+            copied++;
+            address++;
+        }
+    }
+
+    out[copied] = 0;
+    return OK;
 }
 
 int task_free(struct task *task) {
@@ -238,7 +409,13 @@ int task_free(struct task *task) {
     }
 
     paging_free_4gb(task->page_directory);
+
+    uint32_t flags = cpu_irq_save();
     task_list_remove(task);
+    cpu_irq_restore(flags);
+
+    fpu_task_free(task);
+    task_free_kernel_stack(task);
 
     // Finally free the task data
     kfree(task);
@@ -255,8 +432,24 @@ void task_current_save_state(struct interrupt_frame *frame) {
 }
 
 int task_switch(struct task *task) {
+    if (task != current_task) {
+        // Charge the time since the last switch to the outgoing task
+        uint64_t now = cpu_read_tsc();
+        if (current_task) {
+            current_task->stats.runtime_cycles += now - task_switched_at;
+        }
+
+        task_switched_at = now;
+        task->stats.context_switches++;
+        vvar_switch(task);
+    }
+
     current_task = task;
     paging_switch(task->page_directory);
+    fpu_task_switch(task);
+
+    // Interrupts and system calls from ring 3 enter on the task's own kernel stack
+    tss.esp0 = task_kernel_stack_top(task);
     return OK;
 }
 
@@ -293,15 +486,88 @@ void *task_get_stack_item(struct task *task, int index) {
 }
 
 void task_next(void) {
+    // Interrupts stay disabled until the next task is entered
+    disable_interrupt();
+    need_resched = false;
+
     struct task *next_task = task_get_next();
     if (!next_task) {
         panick("No more tasks!\n");
     }
 
     task_switch(next_task);
+
+    // A task that gave up the CPU inside the kernel continues there. The kernel context of
+    // the current task is dropped, its user state was saved on entry to the kernel.
+    if (next_task->kernel_esp) {
+        uint32_t esp = next_task->kernel_esp;
+        next_task->kernel_esp = 0;
+        task_context_switch(&task_discarded_esp, esp);
+    }
+
     task_return(&next_task->registers);
 }
 
+void task_yield(void) {
+    // preempt_count is not saved per task, so switching now would hand it to the next task. The
+    // switch happens in the matching preempt_enable() instead.
+    if (!preemptible()) {
+        need_resched = true;
+        return;
+    }
+
+    uint32_t flags = cpu_irq_save();
+    need_resched = false;
+
+    struct task *prev_task = current_task;
+    struct task *next_task = prev_task ? task_get_next() : NULL;
+    if (!next_task || next_task == prev_task) {
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    task_switch(next_task);
+
+    uint32_t esp = next_task->kernel_esp;
+    next_task->kernel_esp = 0;
+    if (!esp) {
+        esp = task_kernel_context_init(next_task);
+    }
+
+    task_context_switch(&prev_task->kernel_esp, esp);
+
+    // Resumed by task_next() or task_yield() of another task, which already switched back to us
+    cpu_irq_restore(flags);
+}
+
+void preempt_disable(void) {
+    preempt_count++;
+}
+
+void preempt_enable(void) {
+    if (preempt_count == 0) {
+        return;
+    }
+
+    preempt_count--;
+    if (preempt_count == 0 && need_resched && (cpu_read_eflags() & CPU_EFLAGS_IF)) {
+        task_yield();
+    }
+}
+
+bool preemptible(void) {
+    return preempt_count == 0;
+}
+
+void task_preempt(void) {
+    if (!preemptible()) {
+        need_resched = true;
+        return;
+    }
+
+    task_yield();
+}
+
 void *task_virtual_address_to_physical(struct task *task, void *virtual_address) {
     return paging_get_physical_address(task->page_directory->directory_entry, virtual_address);
 }
@@ -2,6 +2,7 @@
 #define _TASK_H_
 
 #include "config.h"
+#include "cpu/fpu.h"
 #include "memory/paging/paging.h"
 
 /**
@@ -22,6 +23,15 @@ struct registers {
     uint32_t ss;    /**< Stack segment register, holds the segment selector for the stack segment */
 };
 
+/**
+ * @brief CPU accounting for a task.
+ */
+struct task_stats {
+    uint64_t runtime_cycles;   /**< TSC cycles the task has been running, in user and kernel mode */
+    uint32_t context_switches; /**< Number of times the task was switched in */
+    uint32_t syscalls;         /**< Number of system calls made by the task */
+};
+
 /**
  * Forward declaration of the process structure.
  */
@@ -41,6 +51,12 @@ struct task {
     struct process *process;                 /**< The process associated with this task */
     struct task *next;                       /**< Pointer to the next task in the linked list */
     struct task *prev;                       /**< Pointer to the previous task in the linked list */
+    void *kernel_stack;                      /**< The kernel stack used while the task is in ring 0 */
+    uint32_t kernel_esp;                     /**< Saved kernel stack pointer, or 0 if the task has no kernel context */
+    bool kill_pending;                       /**< Killed while inside the kernel, terminated when it leaves */
+    struct task_stats stats;                 /**< CPU accounting for the task */
+    bool fpu_used;                           /**< Whether the task has executed an FPU/SSE instruction */
+    struct fpu_state fpu;                    /**< The saved FPU/SSE registers for the task */
 };
 
 /**
@@ -115,18 +131,45 @@ void *task_get_stack_item(struct task *task, int index);
 /**
  * @brief Copies a string from a task's memory to the kernel space
  *
- * @details This function copies a string from a task's memory to the kernel space. It allocates
- * memory in the kernel space to store the string, copies the string from the task's memory to the
- * kernel space, and then copies the string to the physical address provided.
+ * @details The string is read page by page through the task's page tables, without switching page
+ * directories or allocating. The copy is always null terminated.
  *
  * @param task The task to copy the string from
  * @param virtual The virtual address of the string in the task's memory
- * @param phys The physical address to copy the string to
- * @param max The maximum number of bytes to copy
- * @return int Returns 0 on success, negative value on failure
+ * @param phys The kernel address to copy the string to
+ * @param max The size of the kernel buffer
+ * @return int Returns 0 on success, -EFAULT if the string is not readable from user mode
  */
 int copy_string_from_task(struct task *task, void *virtual, void *phys, int max);
 
+/**
+ * @brief Copies a buffer from a task's memory to the kernel space
+ *
+ * @details The buffer is read page by page through the task's page tables, so it may span pages
+ * that are not physically contiguous. An address user mode may not read fails the copy instead of
+ * faulting.
+ *
+ * @param task The task to copy from
+ * @param dst The kernel address to copy to
+ * @param src The virtual address in the task's memory
+ * @param len The number of bytes to copy
+ * @return int Returns 0 on success, -EFAULT if part of the buffer is not readable from user mode
+ */
+int copy_from_user(struct task *task, void *dst, const void *src, size_t len);
+
+/**
+ * @brief Copies a buffer from the kernel space to a task's memory
+ *
+ * @details The counterpart of copy_from_user(). Every page written must be writable from user mode.
+ *
+ * @param task The task to copy to
+ * @param dst The virtual address in the task's memory
+ * @param src The kernel address to copy from
+ * @param len The number of bytes to copy
+ * @return int Returns 0 on success, -EFAULT if part of the buffer is not writable from user mode
+ */
+int copy_to_user(struct task *task, void *dst, const void *src, size_t len);
+
 /**
  * @brief Handles the task return process, restoring registers, enabling interrupts, and switching to the task's page
  * directory.
@@ -145,6 +188,59 @@ void task_return(struct registers *regs);
  */
 void task_next(void);
 
+/**
+ * @brief Gives up the CPU from inside the kernel
+ *
+ * @details Unlike task_next(), the kernel context of the current task is preserved on its own
+ * kernel stack. When the task is scheduled again, task_yield() returns and the task continues
+ * where it left off (e.g. finishes the system call it was executing). Does not switch while
+ * preemption is disabled; the switch is deferred until the matching preempt_enable().
+ */
+void task_yield(void);
+
+/**
+ * @brief Disables kernel preemption
+ *
+ * @details Calls nest. While preemption is disabled the timer does not switch away from a task
+ * running in the kernel; the switch is deferred until the matching preempt_enable(). Holding a
+ * spinlock disables preemption.
+ */
+void preempt_disable(void);
+
+/**
+ * @brief Re-enables kernel preemption
+ *
+ * @details Performs a deferred task switch if the timer asked for one while preemption was
+ * disabled and interrupts are enabled.
+ */
+void preempt_enable(void);
+
+/**
+ * @brief Checks whether the kernel may switch away from the current task
+ *
+ * @return true if preemption is enabled.
+ */
+bool preemptible(void);
+
+/**
+ * @brief Preempts the current task while it is running in the kernel
+ *
+ * @details Called by the timer when it interrupts a system call. Switches to the next task with
+ * task_yield(), or marks the switch as pending if preemption is disabled.
+ */
+void task_preempt(void);
+
+/**
+ * @brief Switches between kernel contexts
+ *
+ * @details Saves the callee-saved registers on the current stack, stores the stack pointer in
+ * old_esp and resumes the context saved at new_esp.
+ *
+ * @param old_esp Where to store the stack pointer of the current context.
+ * @param new_esp The stack pointer of the context to resume.
+ */
+void task_context_switch(uint32_t *old_esp, uint32_t new_esp);
+
 /**
  * @brief Restores general-purpose registers from the given state.
  *
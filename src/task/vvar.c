@@ -0,0 +1,50 @@
+#include "vvar.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "memory/paging/paging.h"
+#include "process.h"
+#include "task.h"
+
+// The shared page, with nothing else in it since the whole page is visible to user mode
+static uint8_t vvar_page[PAGING_PAGE_SIZE] __attribute__((aligned(PAGING_PAGE_SIZE)));
+static struct vvar *const vvar = (struct vvar *)vvar_page;
+
+/**
+ * @brief Marks the start of an update, so readers retry until vvar_write_end()
+ */
+static void vvar_write_begin(void) {
+    vvar->sequence++;
+    __sync_synchronize();
+}
+
+/**
+ * @brief Marks the end of an update
+ */
+static void vvar_write_end(void) {
+    __sync_synchronize();
+    vvar->sequence++;
+}
+
+int vvar_map(struct paging_4gb_chunk *directory) {
+    vvar->timer_period_us = TOYOS_TIMER_PERIOD_US;
+    return paging_map(directory, (void *)TOYOS_VVAR_ADDRESS, vvar_page, PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+}
+
+void vvar_tick(void) {
+    vvar_write_begin();
+    vvar->ticks++;
+    vvar->tsc_at_tick = cpu_read_tsc();
+    vvar_write_end();
+}
+
+uint32_t vvar_get_ticks(void) {
+    // The low half is written with a single store, so it needs no sequence check
+    return (uint32_t)vvar->ticks;
+}
+
+void vvar_switch(struct task *task) {
+    vvar_write_begin();
+    vvar->pid = task->process ? task->process->id : 0;
+    vvar->process_count = process_get_count();
+    vvar_write_end();
+}
@@ -0,0 +1,53 @@
+#ifndef _VVAR_H_
+#define _VVAR_H_
+
+#include <stdint.h>
+
+// Forward declarations
+struct paging_4gb_chunk;
+struct task;
+
+/**
+ * @brief Kernel data shared read-only with every task
+ *
+ * The page is mapped at TOYOS_VVAR_ADDRESS in every task, so user code can read it without a
+ * system call. The 64-bit fields cannot be read atomically, so readers must retry while the
+ * sequence is odd or changed during the read.
+ */
+struct vvar {
+    volatile uint32_t sequence;     /**< Incremented before and after every update, odd while updating. */
+    volatile uint32_t pid;          /**< ID of the process currently running. */
+    volatile uint32_t process_count; /**< Number of processes. */
+    uint32_t timer_period_us;       /**< Interval between two timer ticks, in microseconds. */
+    volatile uint64_t ticks;        /**< Timer ticks since boot. */
+    volatile uint64_t tsc_at_tick;  /**< TSC value at the last timer tick. */
+};
+
+/**
+ * @brief Maps the shared data page read-only into a task's address space.
+ *
+ * @param directory The task's page directory.
+ * @return 0 on success, negative value on failure.
+ */
+int vvar_map(struct paging_4gb_chunk *directory);
+
+/**
+ * @brief Records a timer tick in the shared data page.
+ */
+void vvar_tick(void);
+
+/**
+ * @brief Returns the number of timer ticks since boot, wrapping at 32 bits.
+ *
+ * @return The low 32 bits of the tick count.
+ */
+uint32_t vvar_get_ticks(void);
+
+/**
+ * @brief Records the process a task belongs to as the one running.
+ *
+ * @param task The task being switched to.
+ */
+void vvar_switch(struct task *task);
+
+#endif
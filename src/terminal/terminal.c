@@ -1,5 +1,6 @@
 #include "terminal.h"
 #include "io/io.h"
+#include "locks/spinlock.h"
 #include "stdlib/string.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -14,6 +15,9 @@ static uint16_t terminal_col = 0;
 // Screen buffer
 static uint16_t screen_buffer[VGA_HEIGHT][VGA_WIDTH];
 
+// Protects the cursor position and screen buffer, the kernel prints from interrupt handlers too
+static struct spinlock_t terminal_lock = SPINLOCK_INIT("terminal");
+
 /**
  * @brief Reads the current cursor position from the VGA hardware.
  *
@@ -146,7 +150,18 @@ void terminal_update_cursor(void) {
     outb(VGA_DATA_PORT, (uint8_t)((position >> 8) & 0xff));
 }
 
-void terminal_writechar(char c, unsigned char fg, unsigned char bg) {
+static void terminal_erase_last(void);
+
+/**
+ * @brief Writes a character at the cursor into the screen buffer with the terminal lock held.
+ *
+ * The VGA memory is not updated, see terminal_put().
+ *
+ * @param c The character to write.
+ * @param fg The foreground color.
+ * @param bg The background color.
+ */
+static void terminal_buffer_put(char c, unsigned char fg, unsigned char bg) {
     if (c == '\n') {
         terminal_row += 1;
         terminal_col = 0;
@@ -155,12 +170,12 @@ void terminal_writechar(char c, unsigned char fg, unsigned char bg) {
             terminal_scroll();
         }
 
-        goto update;
+        return;
     }
 
     if (c == 0x08) {
-        terminal_backspace();
-        goto update;
+        terminal_erase_last();
+        return;
     }
 
     terminal_buffer_putchar(terminal_col, terminal_row, c, ((bg & 0x0f) << 4) | (fg & 0x0f));
@@ -176,12 +191,24 @@ void terminal_writechar(char c, unsigned char fg, unsigned char bg) {
             terminal_scroll();
         }
     }
+}
 
-update:
+/**
+ * @brief Writes a character at the cursor with the terminal lock held.
+ *
+ * @param c The character to write.
+ * @param fg The foreground color.
+ * @param bg The background color.
+ */
+static void terminal_put(char c, unsigned char fg, unsigned char bg) {
+    terminal_buffer_put(c, fg, bg);
     terminal_update_vga_memory();
 }
 
-void terminal_backspace(void) {
+/**
+ * @brief Erases the character before the cursor with the terminal lock held.
+ */
+static void terminal_erase_last(void) {
     if (terminal_row == 0 && terminal_col == 0) {
         return;
     }
@@ -192,10 +219,39 @@ void terminal_backspace(void) {
     }
 
     terminal_col -= 1;
-    terminal_writechar(' ', VGA_COLOR_WHITE, VGA_COLOR_BLUE);
+    terminal_buffer_put(' ', VGA_COLOR_WHITE, VGA_COLOR_BLUE);
     terminal_col -= 1;
 }
 
+void terminal_writechar(char c, unsigned char fg, unsigned char bg) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    terminal_put(c, fg, bg);
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+void terminal_write(const char *str, int len, unsigned char fg, unsigned char bg) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    for (int i = 0; i < len; i++) {
+        terminal_buffer_put(str[i], fg, bg);
+    }
+
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+void terminal_flush(void) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    terminal_update_vga_memory();
+    terminal_update_cursor();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+void terminal_backspace(void) {
+    uint32_t flags = spin_lock_irqsave(&terminal_lock);
+    terminal_erase_last();
+    terminal_update_vga_memory();
+    spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
 void terminal_clear_all(void) {
     for (int y = 0; y < VGA_HEIGHT; y++) {
         for (int x = 0; x < VGA_WIDTH; x++) {
@@ -68,6 +68,24 @@ void terminal_backspace(void);
  */
 void terminal_writechar(char c, unsigned char fg, unsigned char bg);
 
+/**
+ * @brief Writes characters to the screen buffer at the current cursor position.
+ *
+ * Unlike terminal_writechar(), the characters only become visible with the next call to
+ * terminal_flush(), so a long string is copied to VGA memory once instead of once per character.
+ *
+ * @param str The characters to write, which need not be null terminated.
+ * @param len The number of characters to write.
+ * @param fg The foreground color of the characters.
+ * @param bg The background color of the characters.
+ */
+void terminal_write(const char *str, int len, unsigned char fg, unsigned char bg);
+
+/**
+ * @brief Copies the screen buffer to VGA memory and updates the hardware cursor.
+ */
+void terminal_flush(void);
+
 /**
  * @brief Updates the hardware cursor to the current position.
  *
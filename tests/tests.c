@@ -78,13 +78,13 @@ static void print_test_summary(void) {
 static void test_keyboard(void) {
     keyboard_push('A');
     struct process *proc = process_current();
-    register_test("Keyboard push A", proc->keyboard.buffer[0] == 'A');
+    register_test("Keyboard push A", proc->keyboard->buffer[0] == 'A');
 
     keyboard_push('B');
-    register_test("Keyboard push B", proc->keyboard.buffer[1] == 'B');
+    register_test("Keyboard push B", proc->keyboard->buffer[1] == 'B');
 
     keyboard_pop();
-    register_test("Keyboard pop A", proc->keyboard.buffer[0] == 0);
+    register_test("Keyboard pop A", proc->keyboard->buffer[0] == 0);
 }
 
 /**